@@ -0,0 +1,149 @@
+/*
+ * Arena.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// a bump allocator that owns every Token and ParseNode built for one program.
+// objects are never freed one at a time; Release() runs their destructors and
+// hands all of the memory back in one shot
+class Arena {
+    struct Block {
+        Block	*next;
+        size_t	size;
+    };
+    struct Finalizer {
+        Finalizer	*next;
+        void		(*destroy)(void *);
+        void		*obj;
+    };
+
+    Block		*blocks;
+    char		*cur;
+    char		*end;
+    Finalizer	*finalizers;
+    size_t		blockSize;
+    size_t		bytesUsed;
+    size_t		bytesReserved;
+    size_t		blockCount;
+    size_t		objects;
+    size_t		peakUsed;
+
+    template<class T> static void destroy(void *p) { static_cast<T *>(p)->~T(); }
+
+    void grow(size_t n, size_t align) {
+        size_t want = n + align + sizeof(Block);
+        size_t size = want > blockSize ? want : blockSize;
+        Block *b = static_cast<Block *>(std::malloc(size));
+        if( b == 0 )
+            throw std::bad_alloc();
+        b->next = blocks;
+        b->size = size;
+        blocks = b;
+        cur = reinterpret_cast<char *>(b + 1);
+        end = reinterpret_cast<char *>(b) + size;
+        bytesReserved += size;
+        ++blockCount;
+    }
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+public:
+    Arena(size_t blockSize = 64 * 1024) : blocks(0), cur(0), end(0), finalizers(0), blockSize(blockSize),
+        bytesUsed(0), bytesReserved(0), blockCount(0), objects(0), peakUsed(0) {}
+    ~Arena() { Release(); }
+
+    void *Allocate(size_t n, size_t align = alignof(std::max_align_t)) {
+        size_t pad = (align - (reinterpret_cast<size_t>(cur) & (align - 1))) & (align - 1);
+        if( cur == 0 || n + pad > static_cast<size_t>(end - cur) ) {
+            grow(n, align);
+            pad = (align - (reinterpret_cast<size_t>(cur) & (align - 1))) & (align - 1);
+        }
+        char *p = cur + pad;
+        cur = p + n;
+        bytesUsed += n + pad;
+        return p;
+    }
+
+    // construct a T in the arena; its destructor runs at Release()
+    template<class T, class... Args> T *New(Args&&... args) {
+        T *obj = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if( !std::is_trivially_destructible<T>::value ) {
+            Finalizer *f = static_cast<Finalizer *>(Allocate(sizeof(Finalizer), alignof(Finalizer)));
+            f->next = finalizers;
+            f->destroy = &destroy<T>;
+            f->obj = obj;
+            finalizers = f;
+        }
+        ++objects;
+        return obj;
+    }
+
+    // destroy everything in reverse order of construction and free all blocks
+    void Release() {
+        for( Finalizer *f = finalizers; f != 0; f = f->next )
+            f->destroy(f->obj);
+        finalizers = 0;
+        while( blocks ) {
+            Block *next = blocks->next;
+            std::free(blocks);
+            blocks = next;
+        }
+        cur = end = 0;
+        bytesUsed = bytesReserved = blockCount = objects = peakUsed = 0;
+    }
+
+    // a point to roll the arena back to
+    struct Mark {
+        Block		*blocks;
+        char		*cur;
+        char		*end;
+        Finalizer	*finalizers;
+        size_t		bytesUsed;
+        size_t		objects;
+    };
+    Mark GetMark() const {
+        Mark m = { blocks, cur, end, finalizers, bytesUsed, objects };
+        return m;
+    }
+
+    // destroy everything made since m and free the blocks taken since then,
+    // so a statement's nodes can go as soon as it has run
+    void Rewind(const Mark& m) {
+        if( bytesUsed > peakUsed )
+            peakUsed = bytesUsed;
+        for( Finalizer *f = finalizers; f != m.finalizers; f = f->next )
+            f->destroy(f->obj);
+        finalizers = m.finalizers;
+        while( blocks != m.blocks ) {
+            Block *next = blocks->next;
+            bytesReserved -= blocks->size;
+            --blockCount;
+            std::free(blocks);
+            blocks = next;
+        }
+        cur = m.cur;
+        end = m.end;
+        bytesUsed = m.bytesUsed;
+        objects = m.objects;
+    }
+
+    size_t BytesUsed() const { return bytesUsed; }
+    // the most that was ever in use at once, across rewinds
+    size_t PeakBytesUsed() const { return bytesUsed > peakUsed ? bytesUsed : peakUsed; }
+    size_t BytesReserved() const { return bytesReserved; }
+    size_t Blocks() const { return blockCount; }
+    size_t Objects() const { return objects; }
+};
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,199 @@
+/*
+ * Batch.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+
+#include "Batch.h"
+#include "SourceBuffer.h"
+
+using namespace std;
+
+// one deque of file indexes per worker. a worker takes from the back of its
+// own and, once that is empty, steals from the front of someone else's, so a
+// worker stuck on one long script does not hold up the files queued behind it
+class WorkQueue {
+    struct Lane {
+        mutex		lock;
+        deque<size_t>	items;
+    };
+    vector<Lane>	lanes;
+
+public:
+    WorkQueue(unsigned workers, size_t items) : lanes(workers) {
+        // deal the files out in order, so each worker starts near the front
+        for( size_t i = 0; i < items; i++ )
+            lanes[i % workers].items.push_front(i);
+    }
+
+    bool Next(unsigned worker, size_t& item) {
+        {
+            Lane& own = lanes[worker];
+            lock_guard<mutex> g(own.lock);
+            if( !own.items.empty() ) {
+                item = own.items.back();
+                own.items.pop_back();
+                return true;
+            }
+        }
+        for( size_t k = 1; k < lanes.size(); k++ ) {
+            Lane& victim = lanes[(worker + k) % lanes.size()];
+            lock_guard<mutex> g(victim.lock);
+            if( !victim.items.empty() ) {
+                item = victim.items.front();
+                victim.items.pop_front();
+                return true;
+            }
+        }
+        // nothing is ever added once the workers start, so empty means done
+        return false;
+    }
+};
+
+struct FileResult {
+    string	out;
+    string	err;
+    int		status;
+    size_t	bytes;
+    bool	done;
+    FileResult() : status(0), bytes(0), done(false) {}
+};
+
+bool ReadManifest(const string& path, vector<string>& files) {
+    ifstream in(path.c_str());
+    if( !in.is_open() )
+        return false;
+    string line;
+    while( getline(in, line) ) {
+        size_t e = line.find_last_not_of(" \t\r");
+        if( e == string::npos || line[0] == '#' )
+            continue;
+        files.push_back(line.substr(0, e + 1));
+    }
+    return true;
+}
+
+// where --out-dir puts the output of the named script
+static string outputPath(const string& dir, const string& file) {
+    size_t slash = file.find_last_of('/');
+    string base = slash == string::npos ? file : file.substr(slash + 1);
+    return dir + "/" + base + ".out";
+}
+
+static void runOne(const string& name, const BatchOptions& opts, FileResult& r) {
+    ostringstream out, err;
+    SourceBuffer in;
+    if( in.Open(name.c_str()) == false ) {
+        out << "Could not open " << name << endl;
+        r.status = 1;
+    } else {
+        Interpreter interp(out, err);
+        r.status = opts.stream ? interp.RunStream(in, opts.run) : interp.Run(in, opts.run);
+        r.bytes = in.BytesRead();
+    }
+
+    if( !opts.outDir.empty() ) {
+        string path = outputPath(opts.outDir, name);
+        ofstream file(path.c_str(), ios::binary);
+        file << out.str();
+        if( !file.good() ) {
+            err << "Could not write " << path << endl;
+            r.status = 1;
+        }
+    } else
+        r.out = out.str();
+    r.err = err.str();
+}
+
+// the first two files that --out-dir would write to the same path, as two
+// scripts with the same name in different directories would; false if every
+// file has a path of its own
+static bool sameOutput(const vector<string>& files, const string& dir, size_t& a, size_t& b) {
+    map<string, size_t> seen;
+    for( size_t i = 0; i < files.size(); i++ ) {
+        pair<map<string, size_t>::iterator, bool> p = seen.insert(make_pair(outputPath(dir, files[i]), i));
+        if( !p.second ) {
+            a = p.first->second;
+            b = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+int RunBatch(const vector<string>& files, const BatchOptions& opts) {
+    typedef chrono::steady_clock clock;
+    clock::time_point t0 = clock::now();
+
+    // one file's output would be lost, or both garbled if they ran at once
+    size_t a, b;
+    if( !opts.outDir.empty() && sameOutput(files, opts.outDir, a, b) ) {
+        cerr << files[a] << " and " << files[b] << " would both write " << outputPath(opts.outDir, files[a]) << endl;
+        return 1;
+    }
+
+    unsigned jobs = opts.jobs ? opts.jobs : thread::hardware_concurrency();
+    if( jobs == 0 )
+        jobs = 1;
+    if( jobs > files.size() )
+        jobs = files.empty() ? 1 : (unsigned)files.size();
+
+    vector<FileResult> results(files.size());
+    WorkQueue queue(jobs, files.size());
+    mutex doneLock;
+    condition_variable doneSignal;
+
+    vector<thread> workers;
+    for( unsigned w = 0; w < jobs; w++ ) {
+        workers.push_back(thread([&, w]() {
+            size_t i;
+            while( queue.Next(w, i) ) {
+                runOne(files[i], opts, results[i]);
+                lock_guard<mutex> g(doneLock);
+                results[i].done = true;
+                doneSignal.notify_one();
+            }
+        }));
+    }
+
+    // write each file's output as soon as it and every file before it are done
+    int failed = 0;
+    size_t bytes = 0;
+    for( size_t i = 0; i < files.size(); i++ ) {
+        {
+            unique_lock<mutex> g(doneLock);
+            doneSignal.wait(g, [&]() { return results[i].done; });
+        }
+        FileResult& r = results[i];
+        cout << r.out;
+        cerr << r.err;
+        cerr << files[i] << ": exit " << r.status << endl;
+        if( r.status != 0 )
+            ++failed;
+        bytes += r.bytes;
+        string().swap(r.out);
+        string().swap(r.err);
+    }
+    cout.flush();
+
+    for( size_t w = 0; w < workers.size(); w++ )
+        workers[w].join();
+
+    double s = chrono::duration<double>(clock::now() - t0).count();
+    double mb = bytes / (1024.0 * 1024.0);
+    cerr << "batch: " << files.size() << " files (" << failed << " failed), " << mb << " MB in "
+        << s * 1000 << " ms on " << jobs << " threads, " << files.size() / s << " files/s, "
+        << mb / s << " MB/s" << endl;
+
+    return failed ? 1 : 0;
+}
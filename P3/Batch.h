@@ -0,0 +1,35 @@
+/*
+ * Batch.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <string>
+#include <vector>
+
+#include "Interpreter.h"
+
+// many scripts run by one process. each file gets an Interpreter of its own on
+// one of a pool of threads; what it prints is held until every file before it
+// has been written out, so the output reads as if the files ran one by one
+struct BatchOptions {
+    Interpreter::Options	run;
+    bool					stream;
+    unsigned				jobs;		// threads; 0 for one per core
+    std::string				outDir;		// if set, each file's output goes to outDir/<name>.out
+    BatchOptions() : stream(false), jobs(0) {}
+};
+
+// add the file names listed one per line in path to files. blank lines and
+// lines starting with # are skipped. false if path cannot be read
+bool ReadManifest(const std::string& path, std::vector<std::string>& files);
+
+// run every file, report each one's exit status and the throughput on stderr,
+// and return 0 only if every file succeeded. with outDir set, no file is run
+// if two have the same name, and so would write the same output file
+int RunBatch(const std::vector<std::string>& files, const BatchOptions& opts);
+
+#endif /* BATCH_H_ */
@@ -0,0 +1,380 @@
+/*
+ * Bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "Bench.h"
+#include "ParseNode.h"
+#include "SourceBuffer.h"
+#include "PolyMath.h"
+
+using namespace std;
+
+static bool parseUnsigned(const string& s, unsigned& v) {
+    if( s.empty() || s.find_first_not_of("0123456789") != string::npos )
+        return false;
+    v = (unsigned)strtoul(s.c_str(), 0, 10);
+    return true;
+}
+
+bool ScriptShape::Set(const string& key, const string& value) {
+    unsigned *field =
+        key == "statements" ? &statements :
+        key == "degree" ? &degree :
+        key == "float" ? &floatPercent :
+        key == "depth" ? &depth :
+        key == "idents" ? &identifiers :
+        key == "seed" ? &seed : 0;
+    return field != 0 && parseUnsigned(value, *field);
+}
+
+bool BenchOptions::Set(const string& arg) {
+    size_t eq = arg.find('=');
+    if( eq == string::npos )
+        return false;
+    string key = arg.substr(0, eq);
+    string value = arg.substr(eq + 1);
+    if( key == "format" ) {
+        csv = value == "csv";
+        return csv || value == "json";
+    }
+    if( key == "time" ) {
+        unsigned ms;
+        if( !parseUnsigned(value, ms) )
+            return false;
+        minSeconds = ms / 1000.0;
+        return true;
+    }
+    if( key == "filter" ) {
+        filter = value;
+        return true;
+    }
+    return shape.Set(key, value);
+}
+
+// xorshift, so a seed means the same script everywhere, whatever the
+// standard library's distributions do
+class ScriptRandom {
+    unsigned	state;
+public:
+    explicit ScriptRandom(unsigned seed) : state(seed * 2654435761u + 1) {}
+    unsigned Next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    unsigned Below(unsigned n) { return Next() % n; }
+    bool Percent(unsigned p) { return Below(100) < p; }
+};
+
+// writes expressions that are sure to run: polynomials p0.. are set once and
+// only read after that, scalars s0.. may be set again, and a scalar is only
+// ever added to or subtracted from a polynomial on its right
+class ScriptWriter {
+    const ScriptShape&	shape;
+    ScriptRandom		rnd;
+    ostream&			out;
+    unsigned			polys;
+    unsigned			scalars;
+
+    void intLiteral() { out << rnd.Below(10); }
+    void floatLiteral() { out << rnd.Below(10) << '.' << rnd.Below(100); }
+
+    void scalarLiteral() {
+        if( rnd.Percent(shape.floatPercent) )
+            floatLiteral();
+        else
+            intLiteral();
+    }
+
+    void polyLiteral() {
+        bool isFloat = rnd.Percent(shape.floatPercent);
+        out << '{';
+        for( unsigned k = 0; k <= shape.degree; k++ ) {
+            if( k )
+                out << ',';
+            if( isFloat )
+                floatLiteral();
+            else
+                intLiteral();
+        }
+        out << '}';
+    }
+
+    // spaced, as the lexer takes a '-' right before a digit for a sign
+    void op() { out << ' ' << "+-*"[rnd.Below(3)] << ' '; }
+
+    void scalar(unsigned depth) {
+        if( depth == 0 ) {
+            switch( rnd.Below(4) ) {
+            case 0: scalarLiteral(); break;
+            case 1: out << 'p' << rnd.Below(polys) << '['; scalar(0); out << ']'; break;
+            default: out << 's' << rnd.Below(scalars); break;
+            }
+            return;
+        }
+        out << '(';
+        scalar(depth - 1);
+        op();
+        scalar(depth - 1);
+        out << ')';
+    }
+
+    void poly(unsigned depth) {
+        if( depth == 0 ) {
+            if( rnd.Below(4) == 0 )
+                polyLiteral();
+            else
+                out << 'p' << rnd.Below(polys);
+            return;
+        }
+        out << '(';
+        unsigned form = rnd.Below(4);
+        if( form == 0 ) {
+            // a scalar on the left can only multiply
+            scalar(depth - 1);
+            out << " * ";
+            poly(depth - 1);
+        } else {
+            poly(depth - 1);
+            op();
+            if( form == 1 )
+                scalar(depth - 1);
+            else
+                poly(depth - 1);
+        }
+        out << ')';
+    }
+
+public:
+    ScriptWriter(const ScriptShape& shape, ostream& out) : shape(shape), rnd(shape.seed), out(out) {
+        unsigned idents = shape.identifiers < 2 ? 2 : shape.identifiers;
+        polys = idents / 2;
+        scalars = idents - polys;
+    }
+
+    void Write() {
+        unsigned n = 0;
+        for( unsigned k = 0; k < polys; k++, n++ ) {
+            out << "set p" << k << ' ';
+            polyLiteral();
+            out << ";\n";
+        }
+        for( unsigned k = 0; k < scalars; k++, n++ ) {
+            out << "set s" << k << ' ';
+            scalarLiteral();
+            out << ";\n";
+        }
+        for( ; n < shape.statements; n++ ) {
+            unsigned kind = rnd.Below(20);
+            if( kind < 9 ) {
+                out << "set s" << rnd.Below(scalars) << ' ';
+                scalar(shape.depth);
+            } else if( kind < 16 ) {
+                out << "set q" << rnd.Below(polys) << ' ';
+                poly(shape.depth);
+            } else if( kind < 18 ) {
+                out << "print ";
+                scalar(shape.depth);
+            } else if( kind < 19 ) {
+                out << "print ";
+                poly(shape.depth);
+            } else {
+                out << "print p" << rnd.Below(polys) << "[[";
+                for( unsigned k = 0; k < 8; k++ ) {
+                    if( k )
+                        out << ',';
+                    scalarLiteral();
+                }
+                out << "]]";
+            }
+            out << ";\n";
+        }
+    }
+};
+
+void GenerateScript(ostream& out, const ScriptShape& shape) {
+    ScriptWriter(shape, out).Write();
+}
+
+// output that goes nowhere, so whole runs measure the interpreter and not
+// the terminal
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) { return c == EOF ? 0 : c; }
+    streamsize xsputn(const char *, streamsize n) { return n; }
+};
+
+struct BenchResult {
+    string		name;
+    unsigned long	iterations;
+    double		nsPerOp;
+    double		mbPerSec;	// 0 when the benchmark is not over bytes
+};
+
+// results of every benchmark run, and what decides which run at all
+class BenchRunner {
+    const BenchOptions&	opts;
+    volatile unsigned	sink;
+
+public:
+    vector<BenchResult>	results;
+
+    explicit BenchRunner(const BenchOptions& opts) : opts(opts), sink(0) {}
+
+    // call f in ever larger batches until minSeconds have gone by. f returns
+    // something derived from its work, so none of it can be optimized away
+    template<class F> void Time(const string& name, size_t bytes, F f) {
+        typedef chrono::steady_clock clock;
+        if( !opts.filter.empty() && name.find(opts.filter) == string::npos )
+            return;
+
+        unsigned long iterations = 0;
+        unsigned long batch = 1;
+        double seconds = 0;
+        while( seconds < opts.minSeconds ) {
+            clock::time_point t0 = clock::now();
+            for( unsigned long k = 0; k < batch; k++ )
+                sink += f();
+            seconds += chrono::duration<double>(clock::now() - t0).count();
+            iterations += batch;
+            if( batch < (1ul << 20) )
+                batch *= 2;
+        }
+
+        BenchResult r;
+        r.name = name;
+        r.iterations = iterations;
+        r.nsPerOp = seconds * 1e9 / iterations;
+        r.mbPerSec = bytes ? bytes * (double)iterations / seconds / (1024.0 * 1024.0) : 0;
+        results.push_back(r);
+    }
+};
+
+// a polynomial of n coefficients, all small, so products stay in range
+static Value makePoly(unsigned n, bool isFloat, ScriptRandom& rnd) {
+    Value v = Value::Poly(n, isFloat);
+    for( unsigned k = 0; k < n; k++ ) {
+        if( isFloat )
+            v.PolyFloats()[k] = rnd.Below(1000) / 100.0f;
+        else
+            v.PolyInts()[k] = (int)rnd.Below(10);
+    }
+    return v;
+}
+
+static unsigned lexAll(const string& script) {
+    Interpreter interp;
+    istringstream text(script);
+    SourceBuffer in(text);
+    unsigned tokens = 0;
+    while( *getToken(interp, in) != DONE )
+        ++tokens;
+    return tokens;
+}
+
+static unsigned parse(const string& script) {
+    Interpreter interp;
+    istringstream text(script);
+    SourceBuffer in(text);
+    return Prog(interp, in) != 0;
+}
+
+static unsigned run(const string& script, bool useVM) {
+    NullBuffer nowhere;
+    ostream out(&nowhere);
+    Interpreter interp(out, out);
+    istringstream text(script);
+    SourceBuffer in(text);
+    Interpreter::Options opts;
+    opts.useVM = useVM;
+    return interp.Run(in, opts);
+}
+
+static void writeJSON(ostream& out, const BenchOptions& opts, const vector<BenchResult>& results) {
+    const ScriptShape& s = opts.shape;
+    out << "{\n  \"shape\": {\"statements\": " << s.statements << ", \"degree\": " << s.degree
+        << ", \"float\": " << s.floatPercent << ", \"depth\": " << s.depth
+        << ", \"idents\": " << s.identifiers << ", \"seed\": " << s.seed << "},\n"
+        << "  \"kernel\": \"" << PolyEvaluateKernel() << "\",\n  \"results\": [\n";
+    for( size_t k = 0; k < results.size(); k++ ) {
+        const BenchResult& r = results[k];
+        out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.nsPerOp;
+        if( r.mbPerSec )
+            out << ", \"mb_per_s\": " << r.mbPerSec;
+        out << "}" << (k + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}" << endl;
+}
+
+static void writeCSV(ostream& out, const vector<BenchResult>& results) {
+    out << "name,iterations,ns_per_op,mb_per_s\n";
+    for( size_t k = 0; k < results.size(); k++ ) {
+        const BenchResult& r = results[k];
+        out << r.name << ',' << r.iterations << ',' << r.nsPerOp << ',';
+        if( r.mbPerSec )
+            out << r.mbPerSec;
+        out << '\n';
+    }
+    out.flush();
+}
+
+int RunBenchmarks(ostream& out, const BenchOptions& opts) {
+    ostringstream text;
+    GenerateScript(text, opts.shape);
+    const string script = text.str();
+    const size_t bytes = script.size();
+
+    BenchRunner bench(opts);
+
+    bench.Time("lex/getToken", bytes, [&]() { return lexAll(script); });
+    bench.Time("parse/Prog", bytes, [&]() { return parse(script); });
+    bench.Time("run/tree", bytes, [&]() { return run(script, false); });
+    bench.Time("run/vm", bytes, [&]() { return run(script, true); });
+
+    // operands for the Value operators, sized by the shape's degree
+    ScriptRandom rnd(opts.shape.seed);
+    unsigned n = opts.shape.degree + 1;
+    const Value i1(7), i2(3), f1(2.5f), f2(1.25f), str(string("abc"));
+    const Value ip1 = makePoly(n, false, rnd), ip2 = makePoly(n, false, rnd);
+    const Value fp1 = makePoly(n, true, rnd), fp2 = makePoly(n, true, rnd);
+
+    bench.Time("value/int+int", 0, [&]() { return (i1 + i2).GetType(); });
+    bench.Time("value/int*int", 0, [&]() { return (i1 * i2).GetType(); });
+    bench.Time("value/float+float", 0, [&]() { return (f1 + f2).GetType(); });
+    bench.Time("value/float*float", 0, [&]() { return (f1 * f2).GetType(); });
+    bench.Time("value/string*int", 0, [&]() { return (str * i2).GetType(); });
+    bench.Time("value/poly+poly", 0, [&]() { return (ip1 + ip2).PolySize(); });
+    bench.Time("value/poly-poly", 0, [&]() { return (ip1 - ip2).PolySize(); });
+    bench.Time("value/poly+int", 0, [&]() { return (ip1 + i1).PolySize(); });
+    bench.Time("value/poly*int", 0, [&]() { return (ip1 * i1).PolySize(); });
+    bench.Time("value/poly*poly", 0, [&]() { return (ip1 * ip2).PolySize(); });
+    bench.Time("value/fpoly*fpoly", 0, [&]() { return (fp1 * fp2).PolySize(); });
+    bench.Time("value/poly*fpoly", 0, [&]() { return (ip1 * fp1).PolySize(); });
+
+    Interpreter interp;
+    Value points = Value::List(64, false);
+    for( unsigned k = 0; k < 64; k++ )
+        points.PolyInts()[k] = (int)k;
+    bench.Time("evalat/int", 0, [&]() { return EvaluateAt::Apply(interp, ip1, i2).GetType(); });
+    bench.Time("evalat/float", 0, [&]() { return EvaluateAt::Apply(interp, fp1, f2).GetType(); });
+    bench.Time("evalat/int-at-float", 0, [&]() { return EvaluateAt::Apply(interp, ip1, f2).GetType(); });
+    bench.Time("evalat/list64", 0, [&]() { return EvaluateAt::Apply(interp, ip1, points).PolySize(); });
+
+    if( opts.csv )
+        writeCSV(out, bench.results);
+    else
+        writeJSON(out, opts, bench.results);
+
+    // a generated script always runs cleanly; anything else is a bug
+    return run(script, false) || run(script, true) || interp.errorCount ? 1 : 0;
+}
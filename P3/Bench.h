@@ -0,0 +1,49 @@
+/*
+ * Bench.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <iostream>
+#include <string>
+
+// the shape of a synthetic script. the same shape and seed always give the
+// same script, byte for byte, on every platform
+struct ScriptShape {
+    unsigned	statements;
+    unsigned	degree;			// of each polynomial literal
+    unsigned	floatPercent;	// share of literals and polynomials that are float
+    unsigned	depth;			// of the operator tree in each expression
+    unsigned	identifiers;
+    unsigned	seed;
+    ScriptShape() : statements(1000), degree(8), floatPercent(25), depth(3), identifiers(16), seed(1) {}
+
+    // set the field named by key from value; false if there is no such
+    // field or value is not a number
+    bool Set(const std::string& key, const std::string& value);
+};
+
+// write a script of the given shape. every identifier is set before it is
+// used and no statement fails, so the whole script runs
+void GenerateScript(std::ostream& out, const ScriptShape& shape);
+
+struct BenchOptions {
+    ScriptShape	shape;
+    bool		csv;			// otherwise json
+    double		minSeconds;		// to spend timing each benchmark
+    std::string	filter;			// only benchmarks whose names contain this
+    BenchOptions() : csv(false), minSeconds(0.2) {}
+
+    // key=value, for the shape fields as well as format=json|csv, time=<ms>
+    // and filter=<text>
+    bool Set(const std::string& arg);
+};
+
+// time the lexer, the parser, the Value operators, EvaluateAt and whole runs
+// of a generated script, and write the results to out
+int RunBenchmarks(std::ostream& out, const BenchOptions& opts);
+
+#endif /* BENCH_H_ */
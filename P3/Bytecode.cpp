@@ -0,0 +1,135 @@
+/*
+ * Bytecode.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <vector>
+#include <utility>
+
+#include "ParseNode.h"
+#include "Bytecode.h"
+
+using namespace std;
+
+void CompileProgram(ParseNode *program, Bytecode& code) {
+    program->Compile(code);
+    code.Emit(OP_HALT);
+}
+
+// the dispatch loop. every instruction does exactly what the Eval of the node
+// it came from does, errors included, by sharing that node's Apply
+void RunBytecode(const Bytecode& code, Interpreter& interp) {
+    vector<Value>& symb = interp.values;
+    const int *pc = code.code.data();
+    const Value *constants = code.constants.data();
+    vector<Value> stack(16);
+    size_t sp = 0;
+    size_t high = 0;	// the deepest the stack has been this statement
+
+    // the operands an instruction used are left on the stack above sp. they
+    // are cleared when each statement is done, along with valueRegion
+    auto endStatement = [&]() {
+        for( size_t k = 0; k <= high; k++ )
+            stack[k] = Value();
+        high = 0;
+        valueRegion.Reset();
+    };
+    valueRegion.active = true;
+
+    while( true ) {
+        if( sp + 1 >= stack.size() )
+            stack.resize(stack.size() * 2);
+        if( sp > high )
+            high = sp;
+
+        switch( *pc++ ) {
+            case OP_PUSH_CONST:
+                stack[sp++] = constants[*pc++];
+                break;
+            case OP_LOAD_SLOT:
+                stack[sp++] = symb[*pc++];
+                break;
+            case OP_MOVE_SLOT:
+                stack[sp++] = std::move(symb[*pc++]);
+                break;
+            case OP_STORE_SLOT:
+                SetStatement::Apply(interp, *pc++, stack[--sp]);
+                endStatement();
+                break;
+            case OP_ADD:
+                --sp;
+                stack[sp-1] = PlusOp::Apply(interp, std::move(stack[sp-1]), std::move(stack[sp]));
+                break;
+            case OP_SUB:
+                --sp;
+                stack[sp-1] = MinusOp::Apply(interp, std::move(stack[sp-1]), std::move(stack[sp]));
+                break;
+            case OP_MUL:
+                --sp;
+                stack[sp-1] = TimesOp::Apply(interp, stack[sp-1], stack[sp]);
+                break;
+            case OP_ADD_INT:
+                --sp;
+                stack[sp-1] = Scalars<Add,int,int>::Apply(stack[sp-1], stack[sp]);
+                break;
+            case OP_ADD_FLOAT:
+                --sp;
+                stack[sp-1] = Scalars<Add,float,float>::Apply(stack[sp-1], stack[sp]);
+                break;
+            case OP_SUB_INT:
+                --sp;
+                stack[sp-1] = Scalars<Subtract,int,int>::Apply(stack[sp-1], stack[sp]);
+                break;
+            case OP_SUB_FLOAT:
+                --sp;
+                stack[sp-1] = Scalars<Subtract,float,float>::Apply(stack[sp-1], stack[sp]);
+                break;
+            case OP_MUL_INT:
+                --sp;
+                stack[sp-1] = Scalars<Multiply,int,int>::Apply(stack[sp-1], stack[sp]);
+                break;
+            case OP_MUL_FLOAT:
+                --sp;
+                stack[sp-1] = Scalars<Multiply,float,float>::Apply(stack[sp-1], stack[sp]);
+                break;
+            case OP_MUL_FOLDED: {
+                const Value& factors = constants[*pc + 1];
+                stack[sp-1] = FoldedProduct::Apply(interp, factors.PolyInts(), factors.PolySize(),
+                                                   constants[*pc].GetIntValue(), stack[sp-1]);
+                pc++;
+                break;
+            }
+            case OP_SUM: {
+                const Value& signs = constants[*pc++];
+                unsigned n = signs.PolySize() + 1;
+                sp -= n;
+                Value sum = SumNode::Apply(interp, &stack[sp], signs.PolyInts(), n);
+                stack[sp++] = std::move(sum);
+                break;
+            }
+            case OP_EVAL_AT:
+                --sp;
+                stack[sp-1] = EvaluateAt::Apply(interp, stack[sp-1], stack[sp]);
+                break;
+            case OP_EVAL_AT_SLOT: {
+                int slot = *pc++;
+                stack[sp-1] = EvaluateAt::ApplySlot(interp, slot, symb[slot], stack[sp-1]);
+                break;
+            }
+            case OP_MAKE_LIST: {
+                int n = *pc++;
+                sp -= n;
+                Value list = PointList::Apply(interp, &stack[sp], n);
+                stack[sp++] = std::move(list);
+                break;
+            }
+            case OP_PRINT:
+                PrintStatement::Apply(interp, stack[--sp]);
+                endStatement();
+                break;
+            case OP_HALT:
+                valueRegion.active = false;
+                return;
+        }
+    }
+}
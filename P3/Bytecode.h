@@ -0,0 +1,69 @@
+/*
+ * Bytecode.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef BYTECODE_H_
+#define BYTECODE_H_
+
+#include <vector>
+
+#include "Value.h"
+
+// instructions for the stack machine. operands follow their opcode in the
+// instruction stream
+enum OpCode {
+    OP_PUSH_CONST,  // k: push constants[k]
+    OP_LOAD_SLOT,   // s: push the value of variable slot s
+    OP_MOVE_SLOT,   // s: the same, emptying the slot, as its last read before
+                    //    it is stored to
+    OP_STORE_SLOT,  // s: pop into variable slot s
+    OP_ADD,         // pop b, pop a, push a + b
+    OP_SUB,         // pop b, pop a, push a - b
+    OP_MUL,         // pop b, pop a, push a * b
+    OP_ADD_INT,     // the same for operands known to be ints
+    OP_SUB_INT,
+    OP_MUL_INT,
+    OP_ADD_FLOAT,   // and known to be floats
+    OP_SUB_FLOAT,
+    OP_MUL_FLOAT,
+    OP_MUL_FOLDED,  // k: pop x, push x times the folded product constants[k],
+                    //    whose factors are the list constants[k+1]
+    OP_SUM,         // k: pop n values, push their sum, the signs of whose
+                    //    operators are the list constants[k] of n-1
+    OP_EVAL_AT,     // pop x, pop p, push p evaluated at x
+    OP_EVAL_AT_SLOT,// s: pop x, push variable slot s evaluated at x
+    OP_MAKE_LIST,   // n: pop n values, push them as a list of points
+    OP_PRINT,       // pop and print
+    OP_HALT,
+};
+
+// a whole program compiled to one linear instruction stream
+class Bytecode {
+public:
+    std::vector<int>	code;
+    std::vector<Value>	constants;
+
+    void Emit(OpCode op) { code.push_back(op); }
+    void Emit(OpCode op, int arg) {
+        code.push_back(op);
+        code.push_back(arg);
+    }
+    int AddConstant(const Value& v) {
+        constants.push_back(v);
+        return (int)constants.size() - 1;
+    }
+};
+
+class ParseNode;
+
+// translate a checked program, ending it with OP_HALT
+extern void CompileProgram(ParseNode *program, Bytecode& code);
+
+class Interpreter;
+
+// run compiled code against the variables of interp
+extern void RunBytecode(const Bytecode& code, Interpreter& interp);
+
+#endif /* BYTECODE_H_ */
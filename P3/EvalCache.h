@@ -0,0 +1,181 @@
+/*
+ * EvalCache.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef EVALCACHE_H_
+#define EVALCACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Value.h"
+
+// the values of p[x] already worked out, for a polynomial held in a variable
+// at a scalar point. an entry is keyed by the variable's slot and its version,
+// which SetStatement bumps, so setting the variable again leaves its old
+// entries unreachable; they are the first to go as the least recently used.
+// the table is open addressed over a fixed pool of entries, so a lookup
+// allocates nothing
+class EvalCache {
+    struct Entry {
+        uint64_t	poly;		// slot << 32 | version
+        uint64_t	point;		// type << 32 | the point's bits
+        Type		t;			// of the result
+        uint32_t	bits;
+        int			newer;		// the recency list, by index
+        int			older;
+    };
+
+    std::vector<Entry>	entries;
+    std::vector<int>	table;		// entry index or -1
+    size_t				mask;
+    size_t				capacity;
+    int					newest;
+    int					oldest;
+
+    static uint64_t pointKey(const Value& x) {
+        uint32_t bits;
+        if( x.GetType() == INTEGERVAL ) {
+            int i = x.GetIntValue();
+            memcpy(&bits, &i, sizeof bits);
+        } else {
+            float f = x.GetFloatValue();
+            memcpy(&bits, &f, sizeof bits);
+        }
+        return (uint64_t)x.GetType() << 32 | bits;
+    }
+    size_t home(uint64_t poly, uint64_t point) const {
+        uint64_t h = (poly * 0x9E3779B97F4A7C15ull) ^ (point * 0xC2B2AE3D27D4EB4Full);
+        return (size_t)(h ^ (h >> 32)) & mask;
+    }
+
+    void unlink(int e) {
+        Entry& en = entries[e];
+        if( en.newer >= 0 ) entries[en.newer].older = en.older; else newest = en.older;
+        if( en.older >= 0 ) entries[en.older].newer = en.newer; else oldest = en.newer;
+    }
+    void pushNewest(int e) {
+        entries[e].newer = -1;
+        entries[e].older = newest;
+        if( newest >= 0 ) entries[newest].newer = e; else oldest = e;
+        newest = e;
+    }
+
+    // take entry e out of the table, moving later entries of its run back
+    // so no probe sequence is broken
+    void erase(int e) {
+        size_t i = home(entries[e].poly, entries[e].point);
+        while( table[i] != e )
+            i = (i + 1) & mask;
+        size_t j = i;
+        while( true ) {
+            table[i] = -1;
+            while( true ) {
+                j = (j + 1) & mask;
+                if( table[j] < 0 )
+                    return;
+                size_t k = home(entries[table[j]].poly, entries[table[j]].point);
+                // the entry at j can move back to i only if its home is not
+                // in (i, j]
+                if( i <= j ? (i < k && k <= j) : (i < k || k <= j) )
+                    continue;
+                break;
+            }
+            table[i] = table[j];
+            i = j;
+        }
+    }
+
+public:
+    unsigned long	hits;
+    unsigned long	misses;
+    unsigned long	evictions;
+
+    // the smallest polynomial worth a lookup; below this Horner's rule is
+    // about as quick as hashing the key
+    static const unsigned MinTerms = 16;
+
+    explicit EvalCache(size_t capacity = 0) : hits(0), misses(0), evictions(0) { Resize(capacity); }
+
+    // drop every entry and hold at most capacity from now on; 0 turns the
+    // cache off
+    void Resize(size_t capacity) {
+        this->capacity = capacity;
+        entries.clear();
+        entries.reserve(capacity);
+        size_t n = 1;
+        while( n < 2 * capacity )
+            n <<= 1;
+        table.assign(capacity ? n : 0, -1);
+        mask = n - 1;
+        newest = oldest = -1;
+    }
+    size_t Capacity() const { return capacity; }
+    bool Enabled() const { return !table.empty(); }
+
+    // the value of the polynomial in slot at version, at the scalar x, if
+    // it is known
+    bool Find(int slot, unsigned version, const Value& x, Value& result) {
+        uint64_t poly = (uint64_t)slot << 32 | version;
+        uint64_t point = pointKey(x);
+        for( size_t i = home(poly, point); table[i] >= 0; i = (i + 1) & mask ) {
+            int e = table[i];
+            Entry& en = entries[e];
+            if( en.poly == poly && en.point == point ) {
+                if( e != newest ) {
+                    unlink(e);
+                    pushNewest(e);
+                }
+                ++hits;
+                if( en.t == INTEGERVAL ) {
+                    int v;
+                    memcpy(&v, &en.bits, sizeof v);
+                    result = Value(v);
+                } else {
+                    float v;
+                    memcpy(&v, &en.bits, sizeof v);
+                    result = Value(v);
+                }
+                return true;
+            }
+        }
+        ++misses;
+        return false;
+    }
+
+    // remember result, an int or a float, for a key Find did not have
+    void Insert(int slot, unsigned version, const Value& x, const Value& result) {
+        int e;
+        if( entries.size() < capacity ) {
+            e = (int)entries.size();
+            entries.push_back(Entry());
+        } else {
+            e = oldest;
+            erase(e);
+            unlink(e);
+            ++evictions;
+        }
+        Entry& en = entries[e];
+        en.poly = (uint64_t)slot << 32 | version;
+        en.point = pointKey(x);
+        en.t = result.GetType();
+        if( en.t == INTEGERVAL ) {
+            int v = result.GetIntValue();
+            memcpy(&en.bits, &v, sizeof v);
+        } else {
+            float v = result.GetFloatValue();
+            memcpy(&en.bits, &v, sizeof v);
+        }
+        size_t i = home(en.poly, en.point);
+        while( table[i] >= 0 )
+            i = (i + 1) & mask;
+        table[i] = e;
+        pushNewest(e);
+    }
+};
+
+#endif /* EVALCACHE_H_ */
@@ -0,0 +1,218 @@
+/*
+ * HashCons.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "ParseNode.h"
+
+using namespace std;
+
+// two walks over the tree, both with explicit stacks since a program's
+// statement list and its operator chains can be very long. the first gives
+// every node a key, the same for every copy of the same subtree, and counts
+// the copies of each; the second keeps the first copy of each repeated
+// subtree and points every other use at it. keys are found through an open
+// addressed table of hashes; a hash that matches is checked against the
+// first node given that key, so a collision cannot merge different trees
+class SubtreeSharing {
+    Interpreter&			interp;
+    vector<int>				table;		// key or -1, by hash
+    vector<uint64_t>		hashes;		// by key
+    vector<ParseNode *>		first;		// by key: the first node given it
+    vector<unsigned>		copies;		// by key
+    vector<ParseNode *>		kept;		// by key, once Share has seen it
+    vector<ParseNode **>	slots;
+    vector<ParseNode **>	otherSlots;
+    string					sig;
+    string					otherSig;
+
+    static unsigned long size(ParseNode *n);
+    static vector<int> reads(ParseNode *n);
+
+    bool same(ParseNode *other);
+    void grow();
+    void giveKey(ParseNode *n);
+
+public:
+    ShareReport	report;
+
+    explicit SubtreeSharing(Interpreter& interp) : interp(interp) {}
+
+    void Keys(ParseNode *root);
+    void Share(ParseNode *root);
+};
+
+// whether other has the signature in sig and the children in slots
+bool SubtreeSharing::same(ParseNode *other) {
+    otherSig.clear();
+    other->Signature(otherSig);
+    if( otherSig != sig )
+        return false;
+    otherSlots.clear();
+    other->ChildSlots(otherSlots);
+    if( otherSlots.size() != slots.size() )
+        return false;
+    for( size_t i = 0; i < slots.size(); i++ )
+        if( (*otherSlots[i])->shareKey != (*slots[i])->shareKey )
+            return false;
+    return true;
+}
+
+void SubtreeSharing::grow() {
+    table.assign(table.empty() ? 1024 : table.size() * 2, -1);
+    size_t mask = table.size() - 1;
+    for( size_t k = 0; k < hashes.size(); k++ ) {
+        size_t i = hashes[k] & mask;
+        while( table[i] >= 0 )
+            i = (i + 1) & mask;
+        table[i] = (int)k;
+    }
+}
+
+// the key of a node follows from its signature and its children's keys. a
+// node with a child that has no key has none itself
+void SubtreeSharing::giveKey(ParseNode *n) {
+    n->shareKey = -1;
+    sig.clear();
+    if( !n->Signature(sig) )
+        return;
+    slots.clear();
+    n->ChildSlots(slots);
+    // a node with a null child, as x * parses to, is left for Eval to trip
+    // over
+    if( n->AsBinary() && slots.size() != 2 )
+        return;
+
+    // FNV-1a over the signature, then the children's keys
+    uint64_t h = 14695981039346656037ull;
+    for( size_t i = 0; i < sig.size(); i++ )
+        h = (h ^ (unsigned char)sig[i]) * 1099511628211ull;
+    for( size_t i = 0; i < slots.size(); i++ ) {
+        int k = (*slots[i])->shareKey;
+        if( k < 0 )
+            return;
+        h = (h ^ (uint64_t)k) * 1099511628211ull;
+    }
+    h ^= h >> 29;
+
+    if( 2 * (hashes.size() + 1) > table.size() )
+        grow();
+    size_t mask = table.size() - 1;
+    size_t i = h & mask;
+    for( ; table[i] >= 0; i = (i + 1) & mask ) {
+        int k = table[i];
+        if( hashes[k] == h && same(first[k]) ) {
+            n->shareKey = k;
+            ++copies[k];
+            return;
+        }
+    }
+    int k = (int)hashes.size();
+    table[i] = k;
+    hashes.push_back(h);
+    first.push_back(n);
+    copies.push_back(1);
+    kept.push_back(0);
+    n->shareKey = k;
+}
+
+void SubtreeSharing::Keys(ParseNode *root) {
+    // children are keyed before their parent: a node goes on the stack
+    // once to push its children and once more to be keyed
+    vector< pair<ParseNode *,bool> > stack;
+    vector<ParseNode **> children;
+    stack.push_back(make_pair(root, false));
+    while( !stack.empty() ) {
+        ParseNode *n = stack.back().first;
+        bool ready = stack.back().second;
+        stack.pop_back();
+        if( ready ) {
+            giveKey(n);
+            continue;
+        }
+        ++report.nodes;
+        stack.push_back(make_pair(n, true));
+        children.clear();
+        n->ChildSlots(children);
+        for( size_t i = children.size(); i-- > 0; )
+            stack.push_back(make_pair(*children[i], false));
+    }
+}
+
+unsigned long SubtreeSharing::size(ParseNode *n) {
+    unsigned long count = 0;
+    vector<ParseNode *> stack(1, n);
+    vector<ParseNode **> children;
+    while( !stack.empty() ) {
+        ParseNode *m = stack.back();
+        stack.pop_back();
+        ++count;
+        children.clear();
+        m->ChildSlots(children);
+        for( size_t i = 0; i < children.size(); i++ )
+            stack.push_back(*children[i]);
+    }
+    return count;
+}
+
+// the variables a subtree reads, each once
+vector<int> SubtreeSharing::reads(ParseNode *n) {
+    vector<int> slotsRead;
+    vector<ParseNode *> stack(1, n);
+    vector<ParseNode **> children;
+    while( !stack.empty() ) {
+        ParseNode *m = stack.back();
+        stack.pop_back();
+        if( m->ReadsSlot() >= 0 )
+            slotsRead.push_back(m->ReadsSlot());
+        children.clear();
+        m->ChildSlots(children);
+        for( size_t i = 0; i < children.size(); i++ )
+            stack.push_back(*children[i]);
+    }
+    sort(slotsRead.begin(), slotsRead.end());
+    slotsRead.erase(unique(slotsRead.begin(), slotsRead.end()), slotsRead.end());
+    return slotsRead;
+}
+
+void SubtreeSharing::Share(ParseNode *root) {
+    vector<ParseNode **> stack;
+    root->ChildSlots(stack);
+    while( !stack.empty() ) {
+        ParseNode **slot = stack.back();
+        stack.pop_back();
+        ParseNode *n = *slot;
+        int k = n->shareKey;
+        if( k >= 0 && copies[k] > 1 ) {
+            if( kept[k] ) {
+                *slot = kept[k];
+                report.removed += size(n);
+                continue;
+            }
+            // a leaf is as cheap to evaluate as a cached value, so only
+            // needs deduplicating
+            slots.clear();
+            n->ChildSlots(slots);
+            if( slots.empty() )
+                kept[k] = n;
+            else {
+                kept[k] = interp.New<SharedExpr>(n, reads(n));
+                ++report.shared;
+            }
+            *slot = kept[k];
+        }
+        n->ChildSlots(stack);
+    }
+}
+
+ShareReport ShareSubtrees(Interpreter& interp, ParseNode *program) {
+    SubtreeSharing sharing(interp);
+    sharing.Keys(program);
+    sharing.Share(program);
+    return sharing.report;
+}
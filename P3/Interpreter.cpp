@@ -0,0 +1,199 @@
+/*
+ * Interpreter.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <iostream>
+#include <string>
+#include <fstream>
+
+#include "Interpreter.h"
+#include "ParseNode.h"
+#include "SourceBuffer.h"
+
+using namespace std;
+
+Interpreter::Interpreter(ostream& out, ostream& err) : currentLine(0), errorCount(0), firstStatement(true),
+    out(out), err(err) {}
+
+void Interpreter::stamp(ParseNode *n) {
+    n->whichLine = currentLine;
+}
+
+//For parse errors
+void Interpreter::ParseError(const string& s) {
+    out << "PARSE ERROR: " << currentLine << " " << s << '\n';
+    out.Flush();
+    ++errorCount;
+}
+
+//For Runtime Errors
+void Interpreter::RuntimeError(const string& s) {
+    out << "RUNTIME ERROR: " << currentLine << " " << s << '\n';
+    out.Flush();
+    ++errorCount;
+}
+
+// report how much memory the parse of the program took
+static void reportArena(ostream& err, const Arena& arena) {
+    err << "arena: " << arena.Objects() << " objects, "
+        << arena.BytesUsed() << " bytes used, "
+        << arena.BytesReserved() << " bytes reserved in "
+        << arena.Blocks() << " blocks" << endl;
+}
+
+// write the stacks --profile gathered to the named file
+static void writeStacks(ostream& err, const EvalStats& stats, const string& path, bool bytes) {
+    if( path.empty() )
+        return;
+    ofstream file(path.c_str());
+    stats.WriteStacks(file, bytes);
+    if( !file.good() )
+        err << "Could not write " << path << endl;
+}
+
+int Interpreter::finish(const Options& opts, int status) {
+    out.Flush();
+    if( opts.stats ) {
+        stats.Report(err, symbols.Size());
+        if( evalCache.Enabled() )
+            err << "eval cache: " << evalCache.hits << " hits, " << evalCache.misses << " misses, "
+                << evalCache.evictions << " evictions, " << evalCache.Capacity() << " entries" << endl;
+    }
+    if( opts.memReport )
+        err << "region: " << valueRegion.blocks << " blocks, " << valueRegion.bytes << " bytes over "
+            << valueRegion.statements << " statements, " << valueRegion.peak << " bytes in one at most, "
+            << valueRegion.kept << " kept (" << valueRegion.keptBytes << " bytes), "
+            << valueRegion.reserved << " bytes held" << endl;
+    valueRegion.Release();
+    writeStacks(err, stats, opts.profile, false);
+    writeStacks(err, stats, opts.profileBytes, true);
+    return status;
+}
+
+int Interpreter::Run(SourceBuffer& in, const Options& opts) {
+    valueRegion.ClearCounts();
+    if( evalCache.Capacity() != opts.evalCache )
+        evalCache.Resize(opts.evalCache);
+    if( !opts.profile.empty() || !opts.profileBytes.empty() )
+        stats.TracePaths();
+    out.SetLineMode(opts.lineBuffered);
+    ParseNode *program = Prog(*this, in);
+    
+    if( opts.memReport )
+        reportArena(err, arena);
+    
+    if( program == 0 || errorCount > 0 ) {
+        out << "Program failed!\n";
+        return finish(opts, 1);
+    }
+    
+    program->RunStaticChecks(*this);
+    values.resize(symbols.Size());
+    versions.resize(symbols.Size());
+    types.resize(symbols.Size());
+    
+    program = program->Fold(*this);
+    if( opts.specialize )
+        program = SpecializeTypes(*this, program);
+    if( opts.Sharing() ) {
+        ShareReport r = ShareSubtrees(*this, program);
+        if( opts.shareReport )
+            err << "cse: " << r.removed << " of " << r.nodes << " nodes removed, "
+                << r.shared << " subexpressions shared" << endl;
+    }
+    if( opts.dumpFolded )
+        program->Dump(err, 0);
+    // the VM runs bytecode, which has no nodes to time. the list itself is
+    // not wrapped, so each statement's line is at the bottom of its stacks
+    if( opts.Profiling() && !opts.useVM )
+        program->Instrument(*this);
+    
+    if( opts.useVM ) {
+        Bytecode code;
+        CompileProgram(program, code);
+        RunBytecode(code, *this);
+    } else
+        program->Eval(*this);
+    
+    if( errorCount > 0 ) {
+        out << "Program failed!\n";
+        return finish(opts, 1);
+    }
+    return finish(opts, 0);
+}
+
+// statements are parsed, checked and run one at a time, giving back each
+// statement's nodes and input once it has run, so memory is bounded by the
+// largest statement rather than the whole script. output of a statement
+// appears before the next is read. unlike a whole program run, the
+// statements before a parse error have already run when it is found, and an
+// identifier used before it is set is reported when its statement comes to
+// be checked, after the output of those before it. --cse shares the
+// subexpressions repeated within a statement, and --dump-folded dumps each
+// statement as it is about to run
+int Interpreter::RunStream(SourceBuffer& in, const Options& opts) {
+    valueRegion.ClearCounts();
+    if( evalCache.Capacity() != opts.evalCache )
+        evalCache.Resize(opts.evalCache);
+    if( !opts.profile.empty() || !opts.profileBytes.empty() )
+        stats.TracePaths();
+    out.SetLineMode(opts.lineBuffered);
+    in.Tie(&out);
+    int statements = 0;
+    ShareReport shared;
+    
+    while( true ) {
+        Arena::Mark mark = arena.GetMark();
+        ParseNode *stmt = NextStmt(*this, in);
+        if( stmt == 0 )
+            break;
+        ++statements;
+        
+        stmt->RunStaticChecks(*this);
+        values.resize(symbols.Size());
+        versions.resize(symbols.Size());
+        types.resize(symbols.Size());
+        stmt = stmt->Fold(*this);
+        if( opts.specialize )
+            stmt = SpecializeTypes(*this, stmt);
+        if( opts.Sharing() ) {
+            ShareReport r = ShareSubtrees(*this, stmt);
+            shared.nodes += r.nodes;
+            shared.removed += r.removed;
+            shared.shared += r.shared;
+        }
+        if( opts.dumpFolded )
+            stmt->Dump(err, 0);
+        if( opts.Profiling() && !opts.useVM )
+            stmt = ProfileStatement(*this, stmt);
+        if( opts.useVM ) {
+            Bytecode code;
+            CompileProgram(stmt, code);
+            RunBytecode(code, *this);
+        } else {
+            ValueRegion::Statement region(valueRegion);
+            stmt->Eval(*this);
+        }
+        
+        // a token put back for the next statement lives in this one's
+        // memory, so keep it all until the parser has moved on
+        if( tokenQueue.empty() ) {
+            arena.Rewind(mark);
+            in.Release();
+        }
+    }
+    
+    if( opts.shareReport && opts.Sharing() )
+        err << "cse: " << shared.removed << " of " << shared.nodes << " nodes removed, "
+            << shared.shared << " subexpressions shared" << endl;
+    if( opts.memReport )
+        err << "arena: " << arena.PeakBytesUsed() << " bytes used at most, " << arena.Objects()
+            << " objects and " << arena.BytesReserved() << " bytes still held" << endl;
+    
+    if( statements == 0 || errorCount > 0 ) {
+        out << "Program failed!\n";
+        return finish(opts, 1);
+    }
+    return finish(opts, 0);
+}
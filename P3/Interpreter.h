@@ -0,0 +1,140 @@
+/*
+ * Interpreter.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INTERPRETER_H_
+#define INTERPRETER_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <stack>
+#include <utility>
+
+#include "polylex.h"
+#include "Arena.h"
+#include "Value.h"
+#include "Stats.h"
+#include "EvalCache.h"
+#include "Output.h"
+
+class ParseNode;
+class BinaryOp;
+class SourceBuffer;
+
+// every identifier gets a dense slot number during the static checks; at run
+// time its value lives at that index of a vector<Value>
+class SymbolTable {
+    std::map<std::string,int>	slots;
+    std::vector<bool>			isSet;
+public:
+    int Slot(const std::string& id) {
+        std::map<std::string,int>::iterator it = slots.find(id);
+        if( it != slots.end() )
+            return it->second;
+        int slot = (int)isSet.size();
+        slots[id] = slot;
+        isSet.push_back(false);
+        return slot;
+    }
+    bool IsSet(int slot) const { return isSet[slot]; }
+    void MarkSet(int slot) { isSet[slot] = true; }
+    int Size() const { return (int)isSet.size(); }
+};
+
+// everything one program needs while it is lexed, parsed, checked and run:
+// the line the lexer is on, tokens put back by the parser, the error count,
+// the variables and the memory for the parse tree. nothing is shared between
+// two Interpreters, so each can run its own program on its own thread
+class Interpreter {
+    void stamp(ParseNode *n);
+    void stamp(const void *) {}
+
+    Interpreter(const Interpreter&);
+    Interpreter& operator=(const Interpreter&);
+
+public:
+    int					currentLine;
+    int					errorCount;
+    bool				firstStatement;
+    std::stack<Token *>	tokenQueue;		// tokens the parser put back
+
+    Arena				arena;			// every Token and ParseNode of the program
+    SymbolTable			symbols;
+    std::vector<Value>	values;			// the variables, by slot
+    std::vector<unsigned>	versions;	// how many times each has been set
+    std::vector<StaticType>	types;		// as SpecializeTypes has them so far
+
+    // scratch for BinaryOp's walk down an operator chain
+    std::vector<BinaryOp *>	spine;
+    std::vector<Value>		operands;
+    std::vector<StaticType>	operandTypes;
+
+    EvalStats			stats;			// for --stats
+    EvalCache			evalCache;		// p[x] for polynomials in variables
+
+    Output				out;			// what the program prints, and its errors
+    std::ostream		&err;			// reports asked for on the command line
+
+    Interpreter(std::ostream& out = std::cout, std::ostream& err = std::cerr);
+
+    void ParseError(const std::string& s);
+    void RuntimeError(const std::string& s);
+
+    // construct a T in the arena. a ParseNode is stamped with the line the
+    // lexer is on, as it would be when the parser makes it
+    template<class T, class... Args> T *New(Args&&... args) {
+        T *obj = arena.New<T>(std::forward<Args>(args)...);
+        stamp(obj);
+        return obj;
+    }
+    Token *NewToken(TokenTypes t, const char *text, unsigned len) {
+        ++stats.tokens[t];
+        return arena.New<Token>(t, text, len, currentLine);
+    }
+    Token *NewToken(TokenTypes t, const char *text) {
+        return NewToken(t, text, (unsigned)strlen(text));
+    }
+
+    struct Options {
+        bool	useVM;
+        bool	dumpFolded;
+        bool	memReport;
+        bool	stats;
+        bool	share;			// ShareSubtrees before running
+        bool	shareReport;
+        std::string	profile;		// files for --profile and --profile-bytes
+        std::string	profileBytes;
+        size_t	evalCache;		// entries for p[x]; 0, the default, for none
+        bool	specialize;		// SpecializeTypes after folding
+        bool	lineBuffered;	// flush the output at the end of every line
+        Options() : useVM(false), dumpFolded(false), memReport(false), stats(false), share(false),
+            shareReport(false), evalCache(0), specialize(false),
+            lineBuffered(false) {}
+
+        // whether the tree has to be wrapped to time its nodes
+        bool Profiling() const { return stats || !profile.empty() || !profileBytes.empty(); }
+        // whether --cse is to share subtrees. the VM has no use for a DAG,
+        // and profiling would wrap a shared node once for every use, so both
+        // get the tree as written
+        bool Sharing() const { return share && !useVM && !Profiling(); }
+    };
+
+    // parse the whole program, then check, fold and run it. returns the exit
+    // status, having printed "Program failed!" if there were any errors
+    int Run(SourceBuffer& in, const Options& opts);
+
+    // the same, one statement at a time, giving back each statement's memory
+    // once it has run
+    int RunStream(SourceBuffer& in, const Options& opts);
+
+private:
+    // print the --stats table and write the --profile stacks, if they were
+    // asked for; returns status
+    int finish(const Options& opts, int status);
+};
+
+#endif /* INTERPRETER_H_ */
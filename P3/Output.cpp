@@ -0,0 +1,129 @@
+/*
+ * Output.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+
+#include "Output.h"
+
+using namespace std;
+
+// s does not fit after what is in the buffer, so the buffer goes to the
+// stream, and s after it if it would fill the buffer by itself
+void Output::spill(const char *s, size_t n) {
+    out.write(buf, used);
+    used = 0;
+    if( n >= size )
+        out.write(s, n);
+    else {
+        memcpy(buf, s, n);
+        used = n;
+    }
+}
+
+// the decimal digits of n, written backwards from end; returns the first
+static char *digits(char *end, uint64_t n) {
+    do {
+        *--end = (char)('0' + n % 10);
+        n /= 10;
+    } while( n );
+    return end;
+}
+
+Output& Output::operator<<(int i) {
+    char text[16];
+    char *end = text + sizeof text;
+    char *p = digits(end, i < 0 ? 0u - (unsigned)i : (unsigned)i);
+    if( i < 0 )
+        *--p = '-';
+    Write(p, end - p);
+    return *this;
+}
+
+// f as %.6g into text, if f is one of the floats that come out without an
+// exponent: an integer of at most six digits, or a fraction from 0.0001 up.
+// a float is m / 2^s exactly, so its six significant digits are the
+// quotient of m * 10^k by 2^s, for the k that leaves six before the point,
+// rounded half to even on the exact remainder as printf does. false for any
+// other float, which printf itself formats
+static bool formatShort(float f, char *text, size_t& n) {
+    static const uint64_t Six = 100000, Seven = 1000000;
+    float a = fabsf(f);
+    if( !(a < 1e6f) )
+        return false;
+    char *p = text;
+    if( signbit(f) )
+        *p++ = '-';
+    if( a == truncf(a) ) {
+        char number[8];
+        char *end = number + sizeof number;
+        char *start = digits(end, (uint64_t)a);
+        memcpy(p, start, end - start);
+        n = p + (end - start) - text;
+        return true;
+    }
+
+    int e;
+    uint64_t m = (uint64_t)ldexpf(frexpf(a, &e), 24);
+    int s = 24 - e;		// a is m / 2^s, and not an integer, so s > 0
+    if( s > 40 )
+        return false;
+    // x, the decimal exponent of a, is where m * 10^(5-x) / 2^s first has
+    // six digits
+    int x = 5;
+    uint64_t scaled = m, q = m >> s;
+    while( q < Six ) {
+        if( --x < -5 )
+            return false;
+        scaled *= 10;
+        q = scaled >> s;
+    }
+    uint64_t r = scaled & (((uint64_t)1 << s) - 1);
+    uint64_t half = (uint64_t)1 << (s - 1);
+    if( r > half || (r == half && (q & 1)) )
+        q++;
+    if( q == Seven ) {
+        q = Six;
+        x++;
+    }
+    if( x < -4 || x > 5 )
+        return false;
+
+    char six[6];
+    digits(six + 6, q);
+    int last = 5;		// the last digit that is not a trailing zero
+    while( six[last] == '0' )
+        last--;
+    if( x >= 0 ) {
+        memcpy(p, six, x + 1);
+        p += x + 1;
+        if( last > x ) {
+            *p++ = '.';
+            memcpy(p, six + x + 1, last - x);
+            p += last - x;
+        }
+    } else {
+        *p++ = '0';
+        *p++ = '.';
+        for( int k = -1; k > x; k-- )
+            *p++ = '0';
+        memcpy(p, six, last + 1);
+        p += last + 1;
+    }
+    n = p - text;
+    return true;
+}
+
+Output& Output::operator<<(float f) {
+    char text[32];
+    size_t n;
+    if( !formatShort(f, text, n) ) {
+        int len = snprintf(text, sizeof text, "%.6g", (double)f);
+        n = len > 0 ? (size_t)len : 0;
+    }
+    Write(text, n);
+    return *this;
+}
@@ -0,0 +1,87 @@
+/*
+ * Output.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// what a program prints, gathered in a buffer of its own and handed to the
+// stream in large writes. the stream only sees it when the buffer fills and
+// at Flush, which the Interpreter calls after an error and when the program
+// is done; in line mode, for a reader watching as it runs, every line is
+// flushed as it ends. numbers are formatted here rather than through the
+// stream's locale, into exactly the characters an ostream with its default
+// flags would give
+class Output {
+    std::ostream&	out;
+    char			*buf;
+    size_t			size;
+    size_t			used;
+    bool			lineMode;
+
+    Output(const Output&);
+    Output& operator=(const Output&);
+
+    void spill(const char *s, size_t n);
+
+public:
+    static const size_t BufferBytes = 64 * 1024;
+
+    explicit Output(std::ostream& out, size_t size = BufferBytes) : out(out), buf(new char[size]), size(size),
+        used(0), lineMode(false) {}
+    ~Output() {
+        Flush();
+        delete[] buf;
+    }
+
+    void SetLineMode(bool on) { lineMode = on; }
+
+    void Write(const char *s, size_t n) {
+        if( n > size - used ) {
+            spill(s, n);
+            return;
+        }
+        memcpy(buf + used, s, n);
+        used += n;
+    }
+    Output& operator<<(char c) {
+        if( used == size )
+            spill(&c, 1);
+        else
+            buf[used++] = c;
+        return *this;
+    }
+    Output& operator<<(const char *s) {
+        Write(s, strlen(s));
+        return *this;
+    }
+    Output& operator<<(const std::string& s) {
+        Write(s.data(), s.size());
+        return *this;
+    }
+    Output& operator<<(int i);
+    // as %g with precision 6, which is what an ostream gives
+    Output& operator<<(float f);
+
+    // a newline, which in line mode goes out at once
+    void EndLine() {
+        *this << '\n';
+        if( lineMode )
+            Flush();
+    }
+    // everything so far to the stream, and the stream to wherever it goes
+    void Flush() {
+        out.write(buf, used);
+        used = 0;
+        out.flush();
+    }
+};
+
+#endif /* OUTPUT_H_ */
@@ -9,48 +9,40 @@
 #include <string>
 #include <stack>
 #include <map>
+#include <typeinfo>
+#include <cstdlib>
+#include <cxxabi.h>
 
 #include "ParseNode.h"
 #include "polylex.h"
+#include "SourceBuffer.h"
 
 using namespace std;
 
-extern int currentLine;
-bool firstStatement = true;
-
-static stack<Token *> tokenQueue = stack<Token *>();
-
-extern map<string,bool> *IdentifierMap;
-
-
-Token *GetToken(istream& in) {
-    if(tokenQueue.size()> 0){
-        Token *n = tokenQueue.top();
-        tokenQueue.pop();
+Token *GetToken(Interpreter& interp, SourceBuffer& in) {
+    if(interp.tokenQueue.size()> 0){
+        Token *n = interp.tokenQueue.top();
+        interp.tokenQueue.pop();
         return n;
     } else {
-        return getToken(in);
+        return getToken(interp, in);
     }
 }
 
 
-//For parse errors
-void parseError(string s) {
-    cout << "PARSE ERROR: " << currentLine << " " << s << endl;
-    ++globalErrorCount;
-}
-//For Runtime Errors
-void runtimeError( string s) {
-    cout << "RUNTIME ERROR: " << currentLine << " " << s << endl;
-    ++globalErrorCount;
+// a token whose lexeme was built up in a string needs its own copy of the text
+static Token *newToken(Interpreter& interp, TokenTypes t, const string& lexeme) {
+    char *text = static_cast<char *>(interp.arena.Allocate(lexeme.size(), 1));
+    lexeme.copy(text, lexeme.size());
+    return interp.NewToken(t, text, (unsigned)lexeme.size());
 }
 
 //function to "putback" tokens
-void PutBackToken(Token& t) {
-    tokenQueue.push(&t);
+void PutBackToken(Interpreter& interp, Token& t) {
+    interp.tokenQueue.push(&t);
 }
 
-Token *getToken(istream& in){
+Token *getToken(Interpreter& interp, istream& in){
     enum State { START, INID, INSTRING, INICONST, INFCONST, INCOMMENT};
 
     State lexstate = START;
@@ -63,7 +55,7 @@ Token *getToken(istream& in){
             break;
         
         if( ch == '\n' ) {
-            currentLine++;
+            interp.currentLine++;
             lexstate = START;
             continue;
         }
@@ -82,28 +74,28 @@ Token *getToken(istream& in){
                     lexeme += ch;
                     continue;
                 } else if(ch == ';'){
-                    return new Token(SC, ";");
+                    return interp.NewToken(SC, ";");
                 } else if(ch == '+'){
-                    return new Token(PLUS, "+");
+                    return interp.NewToken(PLUS, "+");
                 } else if(ch == '*'){
-                    return new Token(STAR, "*");
+                    return interp.NewToken(STAR, "*");
                 } else if(ch == '['){
-                    return new Token(LSQ, "[");
+                    return interp.NewToken(LSQ, "[");
                 } else if(ch == ']'){
-                    return new Token(RSQ, "]");
+                    return interp.NewToken(RSQ, "]");
                 } else if(ch == '('){
-                    return new Token(LPAREN, "(");
+                    return interp.NewToken(LPAREN, "(");
                 } else if(ch == ')'){
-                    return new Token(RPAREN, ")");
+                    return interp.NewToken(RPAREN, ")");
                 } else if( ch == '#' ) {
                     lexstate = INCOMMENT;
                     continue;
                 } else if( ch == '{' ) {
-                    return new Token(LBR, "{");
+                    return interp.NewToken(LBR, "{");
                 } else if( ch == '}' ) {
-                    return new Token(RBR, "}");
+                    return interp.NewToken(RBR, "}");
                 } else if (ch == ','){
-                    return new Token(COMMA, ",");
+                    return interp.NewToken(COMMA, ",");
                 } else if( ch == '"' ) {
                     lexstate = INSTRING;
                     break;
@@ -112,10 +104,10 @@ Token *getToken(istream& in){
                     if( isdigit(in.peek()) ) {
                         lexstate = INICONST;
                         break;
-                    } else return new Token(MINUS, "-");
+                    } else return interp.NewToken(MINUS, "-");
                 } else {
-                    parseError("Error parsing lexeme " + lexeme);
-                    return new Token(ERR,lexeme);
+                    interp.ParseError("Error parsing lexeme " + lexeme);
+                    return newToken(interp, ERR, lexeme);
                 }
                 break;
                 
@@ -123,22 +115,22 @@ Token *getToken(istream& in){
                 if( !isalnum(ch) ) {
                     in.putback(ch);
                     if(lexeme == "set"){
-                        return new Token(SET, lexeme);
+                        return newToken(interp, SET, lexeme);
                     } else if (lexeme == "print"){
-                        return new Token(PRINT, lexeme);
+                        return newToken(interp, PRINT, lexeme);
                     } else
-                        return new Token(ID, lexeme);
+                        return newToken(interp, ID, lexeme);
                 }
                 lexeme += ch;
                 break;
                 
             case INSTRING:
                 if( ch == '"' ) {
-                    return new Token(STRING, lexeme);
+                    return newToken(interp, STRING, lexeme);
                 }
                 else if( ch == '\n' ) {
-                    parseError("string must be in one line.");
-                    return new Token(ERR, lexeme);
+                    interp.ParseError("string must be in one line.");
+                    return newToken(interp, ERR, lexeme);
                 }
                 lexeme += ch;
                 break;
@@ -153,13 +145,13 @@ Token *getToken(istream& in){
                         lexstate = INFCONST;
                         continue;
                     } else {
-                        parseError("Invalid float.");
-                        return new Token(ERR, lexeme);
+                        interp.ParseError("Invalid float.");
+                        return newToken(interp, ERR, lexeme);
                     }
                 } else {
                     in.putback(ch);
                     if(lexeme.length())
-                        return new Token(ICONST, lexeme);
+                        return newToken(interp, ICONST, lexeme);
                 }
                 break;
                 
@@ -170,13 +162,13 @@ Token *getToken(istream& in){
                 } else {
                     in.putback(ch);
                     if(lexeme.length())
-                        return new Token(FCONST, lexeme);
+                        return newToken(interp, FCONST, lexeme);
                 }
                 break;
                 
             case INCOMMENT:
                 if( ch == '\n' ) {
-                    currentLine++;
+                    interp.currentLine++;
                     lexstate = START;
                 }
                 continue;
@@ -186,155 +178,198 @@ Token *getToken(istream& in){
     }
     // handle getting DONE or ERR when not in start state
     if(in.eof()){
-        if( lexstate == START ) return new Token(DONE, "Done");
-        if( lexstate == INSTRING) return new Token(DONE, "Done");
-        if( lexstate == INCOMMENT) return new Token(DONE, "Done");
+        if( lexstate == START ) return interp.NewToken(DONE, "Done");
+        if( lexstate == INSTRING) return interp.NewToken(DONE, "Done");
+        if( lexstate == INCOMMENT) return interp.NewToken(DONE, "Done");
     }
     
-    return new Token(ERR, lexeme);
+    return newToken(interp, ERR, lexeme);
 }
 
 
 // Prog := Stmt | Stmt Prog
-ParseNode *Prog(istream& in) {
-    ParseNode *stmt = Stmt(in);
+ParseNode *Prog(Interpreter& interp, SourceBuffer& in) {
+    StatementList *head = 0, *tail = 0;
     
-    if( stmt != 0 ){
-        return new StatementList(stmt, Prog(in));
-    } else if(currentLine == 0 && (firstStatement)) {
-        firstStatement = false;
-        parseError("Invalid Statement");
+    // each statement is hung off the end of the list as it is parsed
+    while( ParseNode *stmt = NextStmt(interp, in) ) {
+        StatementList *s = interp.New<StatementList>(stmt, (ParseNode *)0);
+        if( tail )
+            tail->SetNext(s);
+        else
+            head = s;
+        tail = s;
     }
-    return 0;
+    return head;
+}
+
+// the next statement of the program, or 0 at its end or at a parse error.
+// Prog strings these together; --stream runs them one at a time
+ParseNode *NextStmt(Interpreter& interp, SourceBuffer& in) {
+    ParseNode *stmt = Stmt(interp, in);
+    
+    if( stmt == 0 && interp.currentLine == 0 && (interp.firstStatement)) {
+        interp.firstStatement = false;
+        interp.ParseError("Invalid Statement");
+    }
+    return stmt;
 }
 
+
+
+
 // Stmt := Set ID Expr SC | PRINT Expr SC
-ParseNode *Stmt(istream& in) {
-    Token *cmd = GetToken(in);
+ParseNode *Stmt(Interpreter& interp, SourceBuffer& in) {
+    Token *cmd = GetToken(interp, in);
     if( *cmd == SET ) {
-        Token *idTok = GetToken(in);
+        Token *idTok = GetToken(interp, in);
         if( *idTok != ID ) {
-            parseError("Identifier required after set");
+            interp.ParseError("Identifier required after set");
             return 0;
         }
-        ParseNode *exp = Expr(in);
+        ParseNode *exp = Expr(interp, in);
         if( exp == 0 ) {
-            parseError("expression required after id in set");
+            interp.ParseError("expression required after id in set");
             return 0;
         }
-        if( *GetToken(in) != SC ) {
-            parseError("semicolon required");
+        if( *GetToken(interp, in) != SC ) {
+            interp.ParseError("semicolon required");
             return 0;
         }
         
-        return new SetStatement(idTok->getLexeme(), exp);
+        return interp.New<SetStatement>(idTok->getLexeme(), exp);
     }
     else if( *cmd == PRINT ) {
-        ParseNode *exp = Expr(in);
+        ParseNode *exp = Expr(interp, in);
         if( exp == 0 ) {
-            parseError("expression required after id in print");
+            interp.ParseError("expression required after id in print");
             return 0;
         }
         
-        if( *GetToken(in) != SC ) {
-            parseError("semicolon required");
+        if( *GetToken(interp, in) != SC ) {
+            interp.ParseError("semicolon required");
             return 0;
         }
         
-        return new PrintStatement(exp);
+        return interp.New<PrintStatement>(exp);
     }
     return 0;
 }
 
 // Expr := Term { (+|-) Expr }
-ParseNode *Expr(istream& in) {
-    ParseNode *t1 = Term(in);
+// parsed in a loop; the tree is still built leaning right, a+(b-(c+...))
+ParseNode *Expr(Interpreter& interp, SourceBuffer& in) {
+    ParseNode *t1 = Term(interp, in);
     if( t1 == 0 ) return 0;
     
     
-    Token *op = GetToken(in);
+    Token *op = GetToken(interp, in);
     if( *op != PLUS && *op != MINUS ) {
-        PutBackToken(*op);
+        PutBackToken(interp, *op);
         return t1;
     }
-    ParseNode *t2 = Expr(in);
     
-    if( t2 == 0 ) {
-        parseError("expression required after + or - operator");
-        return 0;
+    vector<ParseNode *> terms(1, t1);
+    vector<Token *> ops;
+    while( *op == PLUS || *op == MINUS ) {
+        ops.push_back(op);
+        ParseNode *t2 = Term(interp, in);
+        
+        if( t2 == 0 ) {
+            // once for every operator, as each nested Expr used to say it
+            for( size_t i = 0; i < ops.size(); i++ )
+                interp.ParseError("expression required after + or - operator");
+            return 0;
+        }
+        terms.push_back(t2);
+        op = GetToken(interp, in);
     }
+    PutBackToken(interp, *op);
     
-    // combine t1 and t2 together
-    if( *op == PLUS )
-        t1 = new PlusOp(t1, t2);
-    else
-        t1 = new MinusOp(t1, t2);
-    
-    return t1;
+    // combine the terms together from the right
+    ParseNode *e = terms.back();
+    for( size_t i = ops.size(); i-- > 0; ) {
+        if( *ops[i] == PLUS )
+            e = interp.New<PlusOp>(terms[i], e);
+        else
+            e = interp.New<MinusOp>(terms[i], e);
+    }
+    return e;
     
 }
 // Term := Primary { * Primary }
-ParseNode *Term(istream& in) {
-    ParseNode *p = Primary(in);
-    Token *j = GetToken(in);
-    if(*j == STAR){
-        return new TimesOp(p, Term(in));
+ParseNode *Term(Interpreter& interp, SourceBuffer& in) {
+    ParseNode *p = Primary(interp, in);
+    Token *j = GetToken(interp, in);
+    if(*j != STAR){
+        PutBackToken(interp, *j);
+        return p;
     }
-    PutBackToken(*j);
-    return p;
+    
+    vector<ParseNode *> factors(1, p);
+    while(*j == STAR){
+        factors.push_back(Primary(interp, in));
+        j = GetToken(interp, in);
+    }
+    PutBackToken(interp, *j);
+    
+    ParseNode *t = factors.back();
+    for( size_t i = factors.size() - 1; i-- > 0; )
+        t = interp.New<TimesOp>(factors[i], t);
+    return t;
 }
 
 // Primary :=  ICONST | FCONST | STRING | ( Expr ) | Poly
-ParseNode *Primary(istream& in) {
+ParseNode *Primary(Interpreter& interp, SourceBuffer& in) {
     ParseNode *t1 = 0;
-    Token *tt1 = GetToken(in);
+    Token *tt1 = GetToken(interp, in);
     Token *tt2;
     
     if(*tt1 == ICONST){
-        t1 = new Iconst(stoi(tt1->getLexeme()));
+        t1 = interp.New<Iconst>(stoi(tt1->getLexeme()));
     }else if(*tt1 == FCONST){
-        t1 = new Fconst(stof(tt1->getLexeme()));
+        t1 = interp.New<Fconst>(stof(tt1->getLexeme()));
     }else if(*tt1 == STRING){
-        t1 = new Sconst(tt1->getLexeme());
+        t1 = interp.New<Sconst>(tt1->getLexeme());
     }else if(*tt1 == LBR || *tt1 == ID){
-        PutBackToken(*tt1);
-        t1 = Poly(in);
+        PutBackToken(interp, *tt1);
+        t1 = Poly(interp, in);
     }else if(*tt1 == LPAREN){
-        t1 = Expr(in);
-        tt2 = GetToken(in);
+        t1 = Expr(interp, in);
+        tt2 = GetToken(interp, in);
         if(*tt2 != RPAREN){
-            parseError("Parenthesis don't match");
+            interp.ParseError("Parenthesis don't match");
             return 0;
         }
     }else if(*tt1 == ID){
-        t1 = new Ident(tt1->getLexeme());
+        t1 = interp.New<Ident>(tt1->getLexeme());
     } else {
         t1 = 0;
-        PutBackToken(*tt1);
+        PutBackToken(interp, *tt1);
     }
     
     return t1;
 }
 
 // Poly := LCURLY Coeffs RCURLY { EvalAt } | ID { EvalAt }
-ParseNode *Poly(istream& in) {
+ParseNode *Poly(Interpreter& interp, SourceBuffer& in) {
     // note EvalAt is optional
-    Token *tk = GetToken(in);
+    Token *tk = GetToken(interp, in);
     if(*tk == LBR){
         ParseNode *coeffs = 0;
-        coeffs = Coeffs(in);
-        Token *tk2 = GetToken(in);
+        coeffs = Coeffs(interp, in);
+        Token *tk2 = GetToken(interp, in);
         if(coeffs == 0){
-            parseError("No coefficients were specified between brackets");
+            interp.ParseError("No coefficients were specified between brackets");
             return 0;
         }
         if(*tk2 == RBR){
-            Token *tk2 = GetToken(in);
+            Token *tk2 = GetToken(interp, in);
             if(*tk2 == LSQ){
-                PutBackToken(*tk2);
-                return new EvaluateAt(coeffs, EvalAt(in));
+                PutBackToken(interp, *tk2);
+                return interp.New<EvaluateAt>(coeffs, EvalAt(interp, in));
             } else {
-                PutBackToken(*tk2);
+                PutBackToken(interp, *tk2);
                 return coeffs;
             }
             return 0;
@@ -344,81 +379,136 @@ ParseNode *Poly(istream& in) {
         return 0;
         
     } else if (*tk == LSQ){
-        PutBackToken(*tk);
-        return EvalAt(in);
+        PutBackToken(interp, *tk);
+        return EvalAt(interp, in);
     } else if (*tk == ID){
-        Token *tk2 = GetToken(in);
+        Token *tk2 = GetToken(interp, in);
         if(*tk2 == LSQ){
-            PutBackToken(*tk2);
-            return new EvaluateAt(new Ident(tk->getLexeme()), EvalAt(in));
-        }else if(*tk2 == RSQ){
-            PutBackToken(*tk2);
+            PutBackToken(interp, *tk2);
+            return interp.New<EvaluateAt>(interp.New<Ident>(tk->getLexeme()), EvalAt(interp, in));
         }
-            PutBackToken(*tk2);
-        return new Ident(tk->getLexeme());
+        PutBackToken(interp, *tk2);
+        return interp.New<Ident>(tk->getLexeme());
     
     }
     return 0;
 }
-ParseNode *GetOneCoeff(Token& t){
+ParseNode *GetOneCoeff(Interpreter& interp, Token& t){
     if( t == ICONST ) {
-        return new Iconst(stoi(t.getLexeme()));
+        return interp.New<Iconst>(stoi(t.getLexeme()));
     } else if( t == FCONST ) {
-        return new Fconst(stof(t.getLexeme()));
+        return interp.New<Fconst>(stof(t.getLexeme()));
     }
     return 0;
 }
+
+Value Coefficients::Make() {
+    unsigned n = (unsigned)coefficients.size();
+    unsigned floats = 0;
+    for( unsigned i = 0; i < n; i++ ) {
+        if( coefficients[i]->GetType() == FLOATVAL )
+            floats++;
+    }
+    
+    // every coefficient is an Iconst or an Fconst, as GetOneCoeff made it.
+    // with some of each, the polynomial is mixed, and the ints stay ints
+    Value poly = floats == 0 || floats == n ? Value::Poly(n, floats > 0) : Value::MixedPoly(n);
+    for( unsigned i = 0; i < n; i++ ) {
+        ParseNode *c = coefficients[i];
+        if( c->GetType() == FLOATVAL )
+            poly.PolyFloats()[i] = static_cast<Fconst *>(c)->GetFloatValue();
+        else if( floats > 0 )
+            poly.SetInt(i, static_cast<Iconst *>(c)->GetIntValue());
+        else
+            poly.PolyInts()[i] = static_cast<Iconst *>(c)->GetIntValue();
+    }
+    return poly;
+}
+
+// the class name of n, which names its row in the --stats table
+static string nodeKind(ParseNode *n) {
+    const char *mangled = typeid(*n).name();
+    int status;
+    char *name = abi::__cxa_demangle(mangled, 0, 0, &status);
+    string kind = status == 0 ? name : mangled;
+    free(name);
+    return kind;
+}
+
+ParseNode *Profile(Interpreter& interp, ParseNode *n) {
+    if( n == 0 )
+        return 0;
+    n->Instrument(interp);
+    BinaryOp *chain = n->AsBinary();
+    if( chain == 0 )
+        return interp.New<Profiled>(n, interp.stats.Row(nodeKind(n)));
+    
+    vector<NodeStats *> rows;
+    for( BinaryOp *b = chain; b; b = b->rightNode() ? b->rightNode()->AsBinary() : 0 )
+        rows.push_back(interp.stats.Row(nodeKind(b)));
+    return interp.New<ProfiledChain>(chain, rows);
+}
+
+ParseNode *ProfileStatement(Interpreter& interp, ParseNode *stmt) {
+    if( stmt == 0 )
+        return 0;
+    // lines are counted from 0 as the lexer goes, but an editor counts from 1
+    return interp.New<ProfiledStatement>(Profile(interp, stmt), stmt->getLine() + 1);
+}
+
 // notice we don't need a separate rule for ICONST | FCONST
 // this rule checks for a list of length at least one
-ParseNode *Coeffs(istream& in) {
+ParseNode *Coeffs(Interpreter& interp, SourceBuffer& in) {
     vector<ParseNode *> coeffs;
     
-    Token *t = GetToken(in);
+    Token *t = GetToken(interp, in);
     
     if (*t == COMMA) {
-        parseError("No value provided before comma");
+        interp.ParseError("No value provided before comma");
         return 0;
     }
-    ParseNode *p = GetOneCoeff(*t);
+    ParseNode *p = GetOneCoeff(interp, *t);
     if( p == 0 )
         return 0;
     
     coeffs.push_back(p);
     
     while( true ) {
-        t = GetToken(in);
+        t = GetToken(interp, in);
         
         if( *t == COMMA ) {
             
             continue;
         } else if ( *t == RBR){
-            PutBackToken(*t);
-            return new Coefficients(coeffs);
+            PutBackToken(interp, *t);
+            return interp.New<Coefficients>(coeffs);
         } else {
-            p = GetOneCoeff(*t);
+            p = GetOneCoeff(interp, *t);
             if( p == 0 ) {
-                parseError("Missing coefficient after comma");
+                interp.ParseError("Missing coefficient after comma");
                 return 0;
             }
             coeffs.push_back(p);
         }
     }
-    return new Coefficients(coeffs); // Coefficients class must take vector
+    return interp.New<Coefficients>(coeffs); // Coefficients class must take vector
 }
 
 // To evauluate the polynomials
-ParseNode *EvalAt(istream& in) {
-    Token *tk = GetToken(in);
+ParseNode *EvalAt(Interpreter& interp, SourceBuffer& in) {
+    Token *tk = GetToken(interp, in);
     if(*tk == SC){
-        PutBackToken(*tk);
+        PutBackToken(interp, *tk);
         return 0;
     } else if(*tk == LSQ){
-        ParseNode *n = Expr(in);
-        Token *tk2 = GetToken(in);
+        Token *tk1 = GetToken(interp, in);
+        PutBackToken(interp, *tk1);
+        ParseNode *n = *tk1 == LSQ ? Points(interp, in) : Expr(interp, in);
+        Token *tk2 = GetToken(interp, in);
         
 
         if(*tk2 != RSQ){
-            parseError("Square braces don't match");
+            interp.ParseError("Square braces don't match");
             return 0;
         }
         return n;
@@ -427,5 +517,82 @@ ParseNode *EvalAt(istream& in) {
     return 0;
 }
 
+// [ Expr { , Expr } ], the points of a multi-point evaluation
+ParseNode *Points(Interpreter& interp, SourceBuffer& in) {
+    vector<ParseNode *> points;
+    
+    Token *tk = GetToken(interp, in);
+    if(*tk != LSQ){
+        interp.ParseError("Square braces don't match");
+        return 0;
+    }
+    while( true ) {
+        ParseNode *p = Expr(interp, in);
+        if( p == 0 ) {
+            interp.ParseError("Missing point in list");
+            return 0;
+        }
+        points.push_back(p);
+        
+        tk = GetToken(interp, in);
+        if( *tk == RSQ )
+            return interp.New<PointList>(points);
+        if( *tk != COMMA ) {
+            interp.ParseError("Square braces don't match");
+            return 0;
+        }
+    }
+}
+
 
 
+
+// the terms of the chain are its operators' left operands, top down, and the
+// right operand of the last one. the chain is counted first, so that its
+// terms can go straight into the arena
+ParseNode *BinaryOp::fuseSum(Interpreter& interp, ParseNode *chain) {
+    unsigned ops = 0;
+    for( BinaryOp *b = chain->AsBinary(); b && b->sumSign() && b->leftNode() && b->rightNode(); b = b->rightNode()->AsBinary() )
+        ops++;
+    if( ops < 2 )
+        return chain;
+
+    ParseNode **terms = static_cast<ParseNode **>(interp.arena.Allocate((ops + 1) * sizeof(ParseNode *), alignof(ParseNode *)));
+    int *signs = static_cast<int *>(interp.arena.Allocate(ops * sizeof(int), alignof(int)));
+    ParseNode *n = chain;
+    for( unsigned k = 0; k < ops; k++, n = n->rightNode() ) {
+        terms[k] = n->leftNode();
+        signs[k] = n->AsBinary()->sumSign();
+    }
+    terms[ops] = n;
+    return interp.New<SumNode>(chain->AsBinary(), ops + 1, terms, signs);
+}
+
+// constant operands fold to their product. an int literal times an int
+// literal times something else starts (or extends) a FoldedProduct
+ParseNode *TimesOp::FoldOp(Interpreter& interp) {
+    ParseNode *c = FoldConstants(interp, leftNode(), rightNode(), &Value::operator*);
+    if( c )
+        return c;
+    
+    const Value *f = leftNode() ? leftNode()->ConstantValue() : 0;
+    if( f == 0 || f->GetType() != INTEGERVAL )
+        return this;
+    
+    FoldedProduct *fp = dynamic_cast<FoldedProduct *>(rightNode());
+    if( fp ) {
+        vector<int> factors(1, f->GetIntValue());
+        factors.insert(factors.end(), fp->Factors().begin(), fp->Factors().end());
+        return interp.New<FoldedProduct>(factors, fp->leftNode());
+    }
+    
+    TimesOp *inner = dynamic_cast<TimesOp *>(rightNode());
+    const Value *g = inner && inner->leftNode() ? inner->leftNode()->ConstantValue() : 0;
+    if( g && g->GetType() == INTEGERVAL ) {
+        vector<int> factors;
+        factors.push_back(f->GetIntValue());
+        factors.push_back(g->GetIntValue());
+        return interp.New<FoldedProduct>(factors, inner->rightNode());
+    }
+    return this;
+}
@@ -10,8 +10,11 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include <map>
 #include <cmath>
+#include <sstream>
+#include <type_traits>
 
 using std::istream;
 using std::cout;
@@ -20,300 +23,65 @@ using std::string;
 using std::vector;
 using std::map;
 using std::ostream;
+using std::ostringstream;
 
 #include "polylex.h"
+#include "Arena.h"
+#include "Value.h"
+#include "SourceBuffer.h"
+#include "Bytecode.h"
+#include "PolyMath.h"
+#include "Interpreter.h"
 
-extern int globalErrorCount;
-extern int currentLine;
-extern map<string,bool> *IdentifierMap;
-extern void runtimeError(string s);
+class ParseNode;
 
-// objects in the language have one of these types
-enum Type {
-	INTEGERVAL,
-	FLOATVAL,
-	STRINGVAL,
-    POLYVAL,
-	UNKNOWNVAL,
-};
-
-
-// this class will be used in the future to hold results of evaluations
-class Value {
-	int	i;
-	float f;
-	string s;
-	Type	t;
-    vector<Value *> p;
-public:
-	Value(int i) : i(i), f(0), t(INTEGERVAL) {}
-	Value(float f) : i(0), f(f), t(FLOATVAL) {}
-	Value(string s) : i(0), f(0), s(s), t(STRINGVAL) {}
-    Value(vector<Value *> p) : i(0), f(0), p(p), t(POLYVAL) {}
-    Value() : t(UNKNOWNVAL) {}
-
-    Value operator+(const Value& op) const {
-        if( t == INTEGERVAL ) {
-            if( op.t == INTEGERVAL )
-                return Value(i + op.i);
-            else if( op.t == FLOATVAL )
-                return Value((float)i + op.f);
-            else if(op.t == POLYVAL){
-                vector<Value *> *p2 = new vector<Value *>();
-                for(int i = 0; i < op.p.size(); i++){
-                    if(i == op.p.size()-1){
-                        p2->push_back(new Value((*op.p[i]) + this->i));
-                    } else {
-                        p2->push_back(op.p[i]);
-                    }
-                }
-                
-                return Value(*p2);
-
-            }
-        }else if( t == FLOATVAL ) {
-            if( op.t == INTEGERVAL )
-                return Value(f + (float)op.i);
-            else if( op.t == FLOATVAL )
-                return Value(f + op.f);
-        }else if( t == STRINGVAL ) {
-            if( op.t == STRINGVAL )
-                return Value(s + op.s);
-        }else if (t == POLYVAL){
-            vector<Value *> *p2;
-            if( op.t == POLYVAL){
-                p2 =  new vector<Value *>();
-                int j, s;
-                if(p.size() < op.p.size()){
-                    j = (int)(op.p.size() - p.size());
-                    s = j;
-                    for(int i = 0; i < op.p.size(); i++){
-                        if(j){
-                            p2->push_back(op.p[i]);
-                            j--;
-                        }else {
-                            p2->push_back(new Value((*p[i-s]) + (*op.p[i])));
-                        }
-                        
-                    }
-                } else {
-                    j = (int)(p.size() - op.p.size());
-                    s = j;
-                    
-                    for(int i = 0; i < p.size(); i++){
-                        if(j){
-                            p2->push_back(p[i]);
-                        j--;
-                        }else {
-                           
-                            p2->push_back(new Value((*p[i]) + (*op.p[i-s])));  
-                        }
-                    }
-                }
-                return Value(*p2);
-            } else if (op.t == INTEGERVAL){
-                p2 = new vector<Value *>();
-                for(int i = 0; i < p.size(); i++){
-                    if(i == p.size()-1){
-                        p2->push_back(new Value((*p[i]) + op.i));
-                    } else {
-                        p2->push_back(p[i]);
-                    }
-                }
-                
-                return Value(*p2);
-            } else if (op.t == FLOATVAL){
-                p2 = new vector<Value *>();
-                for(int i = 0; i < p.size(); i++){
-                    if(i == p.size()-1){
-                        p2->push_back(new Value((*p[i]) + op));
-                    } else {
-                        p2->push_back(p[i]);
-                    }
-                }
-                
-                return Value(*p2);
-            }
-        }
-        return Value();
-    }
-    
-    Value operator-(const Value& op) const {
-        if( t == INTEGERVAL){
-            if(op.t == INTEGERVAL)
-                return Value(i - op.i);
-            else if (op.t == FLOATVAL)
-                return Value((float)i - op.f);
-            else if(op.t == POLYVAL){
-                vector<Value *> *p2 = new vector<Value *>();
-                for(int i = 0; i < op.p.size(); i++){
-                    if(i == op.p.size()-1){
-                        p2->push_back(new Value((this->i - op.p[i]->i)));
-                    } else {
-                        p2->push_back(new Value(op.p[i]->i * -1));
-                    }
-                }
-                return Value(*p2);
-            }
-        } else if( t == FLOATVAL ){
-            if(op.t == FLOATVAL)
-                return Value(f - op.f);
-            else if(op.t == INTEGERVAL)
-                return Value(f - (float)op.i);
-        } else if (t == POLYVAL){
-            vector<Value *> *p2;
-            if( op.t == POLYVAL){
-                p2 =  new vector<Value *>();
-                int j, s;
-                if(p.size() < op.p.size()){
-                    j = (int)(op.p.size() - p.size());
-                    s = j;
-                    for(int i = 0; i < op.p.size(); i++){
-                        if(j){
-                            p2->push_back(new Value(op.p[i]->i * -1));
-                            j--;
-                        }else {
-                            p2->push_back(new Value((*p[i-s]) - (*op.p[i])));
-                        }
-                        
-                    }
-                } else {
-                    j = (int)(p.size() - op.p.size());
-                    s = j;
-                    
-                    for(int i = 0; i < p.size(); i++){
-                        if(j){
-                            p2->push_back(p[i]);
-                            j--;
-                        }else {
-                            
-                            p2->push_back(new Value((*p[i]) - (*op.p[i-s])));
-                        }
-                    }
-                }
-                return Value(*p2);
-            } else if (op.t == INTEGERVAL){
-                p2 = new vector<Value *>();
-                for(int i = 0; i < p.size(); i++){
-                    if(i == p.size()-1){
-                        p2->push_back(new Value((*p[i])-op));
-                    } else {
-                        p2->push_back(p[i]);
-                    }
-                }
-                
-                return Value(*p2);
-            } else if (op.t == FLOATVAL){
-                p2 = new vector<Value *>();
-                for(int i = 0; i < p.size(); i++){
-                    if(i == p.size()-1){
-                        p2->push_back(new Value((*p[i])-op));
-                    } else {
-                        p2->push_back(new Value(p[i]->i));
-                    }
-                }
-                
-                return Value(*p2);
-            }
-        }
-        return Value();
-    }
-    
-    Value operator*(const Value& op) const {
-        if( t == INTEGERVAL){
-            if(op.t == FLOATVAL){
-                return Value((float)i * op.f);
-            } else if(op.t == INTEGERVAL){
-                return Value(i * op.i);
-            } else if(op.t == STRINGVAL){
-                if(op.t == INTEGERVAL){
-                    string multistring = ""; // consider initializing with value of s
-                    for(int j = 0; j < i; j++){
-                        multistring += op.s;
-                    }
-                    return Value(multistring);
-                }
-            }
-        } else if( t == FLOATVAL){
-            if(op.t == FLOATVAL){
-                return Value(f * op.f);
-            } else if (op.t == INTEGERVAL){
-                return Value(f * (float)op.i);
-            }
-        } else if( t == STRINGVAL){
-            if(op.t == INTEGERVAL){
-                string multistring = ""; // consider initializing with value of s
-                for(unsigned i = 0; i < op.i; i ++){
-                    multistring += s;
-                }
-                return Value(multistring);
-            }
-        }
-        return Value();
-    }
-    
-    
-    Type GetType() { return t; }
-    int GetIntValue(){return i;}
-    float GetFloatValue(){return f;}
-    string GetStringValue(){return s;}
-    vector<Value *> GetPolyValue() {return p; }
-    
-    friend ostream &operator<<( ostream &output, const Value &v ) {
-        if(v.t == INTEGERVAL){
-            output << v.i << endl;
-        } else if(v.t == STRINGVAL){
-            output << v.s << endl;
-        }else if(v.t == FLOATVAL){
-            output << v.f << endl;
-        }else if(v.t == POLYVAL){
-            
-            output << "{ ";
-            for(int i = 0; i < v.p.size(); i++){
-                if(v.p[i]->GetType() == INTEGERVAL){
-                    output << (*v.p[i]).GetIntValue();
-                } else if(v.p[i]->GetType() == FLOATVAL){
-                    output << (*v.p[i]).GetFloatValue();
-                }
-                if(i != v.p.size()-1){
-                    output << ", ";
-                }
-            }
-            output << " }\n";
-        }
-        return output;
-    }
-    Value biggerFirst(vector<Value *> &big, vector<Value *> &small){
-        return Value();
-    }
-};
-
-extern map<string, Value> *Symb;
+// n with every node under it wrapped so that --stats can time it; n itself
+// is wrapped too, and the wrapper is what should replace n
+extern ParseNode *Profile(Interpreter& interp, ParseNode *n);
+// the same for a statement, which also gets a frame for its line
+extern ParseNode *ProfileStatement(Interpreter& interp, ParseNode *stmt);
+// infer the type of every expression in program that can be settled before
+// it runs, and put variants for those types in place of the generic nodes.
+// returns the node that replaces program
+extern ParseNode *SpecializeTypes(Interpreter& interp, ParseNode *program);
 
 // every node in the parse tree is going to be a subclass of this node
 class ParseNode {
 	ParseNode	*left;
 	ParseNode	*right;
     int whichLine;
+    int shareKey;				// scratch for ShareSubtrees
+    friend class Interpreter;	// which stamps the line when it makes a node
+    friend class SubtreeSharing;
 public:
-	ParseNode(ParseNode *left = 0, ParseNode *right = 0) : left(left), right(right) {
-        whichLine = currentLine;
-    }
+	ParseNode(ParseNode *left = 0, ParseNode *right = 0) : left(left), right(right), whichLine(0), shareKey(-1) {}
 	virtual ~ParseNode() {}
 //	virtual Type GetType() { return UNKNOWNVAL; }
     virtual int getLine() { return whichLine; }
-    virtual void RunStaticChecks(map<string,bool>& idMap) {
+    virtual void RunStaticChecks(Interpreter& interp) {
         if( left )
-            left->RunStaticChecks(idMap);
+            left->RunStaticChecks(interp);
         if( right )
-            right->RunStaticChecks(idMap);
+            right->RunStaticChecks(interp);
+    }
+    // give identifiers their slots without reporting anything
+    virtual void Resolve(Interpreter& interp) {
+        if( left )
+            left->Resolve(interp);
+        if( right )
+            right->Resolve(interp);
     }
     virtual Value
-    Eval(map<string,Value>& symb) {
-        if( left ) left->Eval(symb);
-        if( right ) right->Eval(symb);
+    Eval(Interpreter& interp) {
+        if( left ) left->Eval(interp);
+        if( right ) right->Eval(interp);
         return Value();
     }
+    // emit the bytecode that does what Eval does
+    virtual void Compile(Bytecode& code) {
+        if( left ) left->Compile(code);
+        if( right ) right->Compile(code);
+    }
     ParseNode *rightNode() {
         return right;
     };
@@ -322,94 +90,771 @@ public:
         return left;
     };
     virtual Type GetType(){return UNKNOWNVAL;}
+
+    // the value this node always evaluates to, or 0 if it is not a constant
+    virtual const Value *ConstantValue() { return 0; }
+    // fold the constant subtrees below this node; returns the node that
+    // replaces this one, which is this one unless it is constant itself
+    virtual ParseNode *Fold(Interpreter& interp) {
+        if( left ) left = left->Fold(interp);
+        if( right ) right = right->Fold(interp);
+        return this;
+    }
+    // one line describing this node, for --dump-folded
+    virtual string Describe() { return "ParseNode"; }
+    virtual void Dump(ostream& out, int depth) {
+        out << string(2 * depth, ' ') << Describe() << "\n";
+        if( left ) left->Dump(out, depth + 1);
+        if( right ) right->Dump(out, depth + 1);
+    }
+
+    // wrap the nodes below this one for --stats
+    virtual void Instrument(Interpreter& interp) {
+        if( left ) left = Profile(interp, left);
+        if( right ) right = Profile(interp, right);
+    }
+
+    // non-zero for the arithmetic operators, which walk their right spines
+    // in a loop
+    virtual class BinaryOp *AsBinary() { return 0; }
+
+    // for ShareSubtrees: append what this node does, apart from its
+    // children, to sig, so that two nodes with equal signatures and equal
+    // children compute the same value. false if the node is never shared
+    virtual bool Signature(string& sig) { return false; }
+    // the places this node keeps its children, for passes that treat every
+    // node alike
+    virtual void ChildSlots(vector<ParseNode **>& slots) {
+        if( left ) slots.push_back(&left);
+        if( right ) slots.push_back(&right);
+    }
+    // the slot of the variable this node reads, or -1
+    virtual int ReadsSlot() { return -1; }
+    // that read is the last before the variable is set again, so it may
+    // take the value rather than share it
+    virtual void LastRead() {}
+
+    // for SpecializeTypes: set type to what this node will evaluate to, with
+    // the variables' types as they are just before it runs, and return the
+    // node that replaces it. the type is unknown wherever running might fail
+    virtual ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        StaticType t;
+        if( left ) left = left->Specialize(interp, t);
+        if( right ) right = right->Specialize(interp, t);
+        type = StaticType();
+        return this;
+    }
+
+protected:
+    void setLeft(ParseNode *n) { left = n; }
+    void setRight(ParseNode *n) { right = n; }
+};
+// a value known before the program runs; folding replaces constant subtrees
+// with one of these
+class Constant : public ParseNode {
+    Value v;
+public:
+    Constant(const Value& v) : ParseNode(), v(v) {}
+    Value Eval(Interpreter& interp) {
+        return v;
+    }
+    void Compile(Bytecode& code) {
+        code.Emit(OP_PUSH_CONST, code.AddConstant(v));
+    }
+    Type GetType() { return v.GetType(); }
+    const Value *ConstantValue() { return &v; }
+    ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        type = StaticType::Of(v);
+        return this;
+    }
+    // the exact bits of the value, so 0.1 and 0.10000001 stay apart
+    bool Signature(string& sig) {
+        Type t = v.GetType();
+        sig += 'C';
+        sig += (char)t;
+        if( t == INTEGERVAL ) {
+            int i = v.GetIntValue();
+            sig.append((const char *)&i, sizeof i);
+        } else if( t == FLOATVAL ) {
+            float f = v.GetFloatValue();
+            sig.append((const char *)&f, sizeof f);
+        } else if( t == STRINGVAL ) {
+            // a long string is a rope, so never its characters in one piece
+            if( !v.GetStringRep()->AppendShape(sig, 256) )
+                return false;
+        } else if( t == POLYVAL || t == LISTVAL ) {
+            unsigned n = v.PolySize();
+            sig += (char)(v.PolyIsFloat() + 2 * v.PolyMixed());
+            sig.append((const char *)&n, sizeof n);
+            sig.append((const char *)static_cast<const Value&>(v).PolyInts(), n * sizeof(int));
+            // which of a mixed one's coefficients are ints
+            for( unsigned k = 0; v.PolyMixed() && k < n; k++ )
+                sig += (char)v.IsIntAt(k);
+        } else
+            return false;
+        return true;
+    }
+    // a long string by its length and its start
+    string Describe() {
+        ostringstream out;
+        const StringRep *s = v.GetStringRep();
+        if( s && s->length > 64 ) {
+            out << "Constant " << s->Prefix(64) << "... (" << s->length << " characters)";
+            return out.str();
+        }
+        out << v;
+        string text = out.str();
+        if( !text.empty() && text[text.size()-1] == '\n' )
+            text.erase(text.size()-1);
+        return "Constant " + text;
+    }
 };
-extern void runtimeError(string s);
 
-// a list of statements is represented by a statement to the left, and a list of statments to the right
+// op applied to two constants, or 0 when that is an error; the error is left
+// for run time to report
+static inline ParseNode *FoldConstants(Interpreter& interp, ParseNode *l, ParseNode *r, Value (Value::*op)(const Value&) const) {
+    const Value *a = l ? l->ConstantValue() : 0;
+    const Value *b = r ? r->ConstantValue() : 0;
+    if( a == 0 || b == 0 )
+        return 0;
+    Value v = (a->*op)(*b);
+    if( v.GetType() == UNKNOWNVAL )
+        return 0;
+    return interp.New<Constant>(v);
+}
+
+// a list of statements is represented by a statement to the left, and a list of statments to the right.
+// the lists nest as deep as the program is long, so every pass walks them
+// in a loop rather than recursing
 class StatementList : public ParseNode {
+    // the parser only ever puts another list to the right
+    StatementList *next() { return static_cast<StatementList *>(rightNode()); }
 public:
 	StatementList(ParseNode *l, ParseNode *r) : ParseNode(l,r) {}
+    void SetNext(StatementList *n) { setRight(n); }
+
+    void RunStaticChecks(Interpreter& interp) {
+        for( StatementList *s = this; s; s = s->next() )
+            if( s->leftNode() ) s->leftNode()->RunStaticChecks(interp);
+    }
+    void Resolve(Interpreter& interp) {
+        for( StatementList *s = this; s; s = s->next() )
+            if( s->leftNode() ) s->leftNode()->Resolve(interp);
+    }
+    Value Eval(Interpreter& interp) {
+        for( StatementList *s = this; s; s = s->next() )
+            if( s->leftNode() ) {
+                ValueRegion::Statement region(valueRegion);
+                s->leftNode()->Eval(interp);
+            }
+        return Value();
+    }
+    void Compile(Bytecode& code) {
+        for( StatementList *s = this; s; s = s->next() )
+            if( s->leftNode() ) s->leftNode()->Compile(code);
+    }
+    ParseNode *Fold(Interpreter& interp) {
+        for( StatementList *s = this; s; s = s->next() )
+            if( s->leftNode() ) s->setLeft(s->leftNode()->Fold(interp));
+        return this;
+    }
+    // in order, so each statement sees the types the ones before it set
+    ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        StaticType t;
+        for( StatementList *s = this; s; s = s->next() )
+            if( s->leftNode() ) s->setLeft(s->leftNode()->Specialize(interp, t));
+        type = StaticType();
+        return this;
+    }
+    void Instrument(Interpreter& interp) {
+        for( StatementList *s = this; s; s = s->next() )
+            if( s->leftNode() ) s->setLeft(ProfileStatement(interp, s->leftNode()));
+    }
+    // the statements are listed at one level rather than nested
+    void Dump(ostream& out, int depth) {
+        for( StatementList *s = this; s; s = s->next() )
+            if( s->leftNode() ) s->leftNode()->Dump(out, depth);
+    }
 };
 
 // a SetStatement represents the idea of setting id to the value of the Expr pointed to by the left node
 class SetStatement : public ParseNode {
 	string id;
+    int slot;
 public:
-	SetStatement(string id, ParseNode* exp) : id(id), ParseNode(exp) {}
-    void RunStaticChecks(map<string,bool>& idMap)
+	SetStatement(string id, ParseNode* exp) : ParseNode(exp), id(id), slot(-1) {}
+    void RunStaticChecks(Interpreter& interp)
     {
-        idMap[id] = true;
+        leftNode()->Resolve(interp);
+        slot = interp.symbols.Slot(id);
+        interp.symbols.MarkSet(slot);
     }
-    Value Eval(map<string,Value>& symb) {
-        Value op1 = leftNode()->Eval(symb);
+    static void Apply(Interpreter& interp, int slot, const Value& op1) {
         if( op1.GetType() == UNKNOWNVAL ) {
-            runtimeError("Unknown val in set statement.");
+            interp.RuntimeError("Unknown val in set statement.");
         }
-        symb[id] = op1;
+        interp.values[slot] = op1;
+        interp.values[slot].Keep();
+        ++interp.versions[slot];
+    }
+    string Describe() { return "Set " + id; }
+    Value Eval(Interpreter& interp) {
+        Value op1 = leftNode()->Eval(interp);
+        Apply(interp, slot, op1);
         return op1;
     }
-    
+    void Compile(Bytecode& code) {
+        leftNode()->Compile(code);
+        code.Emit(OP_STORE_SLOT, slot);
+    }
+    // if the expression reads the variable it is about to replace just
+    // once, that read can take the value instead of sharing it, so that
+    // set p p + 1 changes p's block in place rather than copying it
+    ParseNode *Fold(Interpreter& interp) {
+        if( leftNode() == 0 )
+            return this;
+        setLeft(leftNode()->Fold(interp));
+        ParseNode *reader = 0;
+        vector<ParseNode *> stack(1, leftNode());
+        vector<ParseNode **> children;
+        while( !stack.empty() ) {
+            ParseNode *n = stack.back();
+            stack.pop_back();
+            if( n->ReadsSlot() == slot ) {
+                if( reader )
+                    return this;
+                reader = n;
+            }
+            children.clear();
+            n->ChildSlots(children);
+            for( size_t i = 0; i < children.size(); i++ )
+                stack.push_back(*children[i]);
+        }
+        if( reader )
+            reader->LastRead();
+        return this;
+    }
+    ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        setLeft(leftNode()->Specialize(interp, type));
+        interp.types[slot] = type;
+        return this;
+    }
+
 };
 
 // a PrintStatement represents the idea of printing the value of the Expr pointed to by the left node
 class PrintStatement : public ParseNode {
 public:
 	PrintStatement(ParseNode* exp) : ParseNode(exp) {}
-    Value Eval(map<string,Value>& symb) {
-        Value op1 = leftNode()->Eval(symb);
+    string Describe() { return "Print"; }
+    static void Apply(Interpreter& interp, const Value& op1) {
         if( op1.GetType() == UNKNOWNVAL ) {
-            runtimeError("Unknown val in set statement.");
+            interp.RuntimeError("Unknown val in set statement.");
         }
-        cout << op1;
+        interp.out << op1;
+    }
+    Value Eval(Interpreter& interp) {
+        Value op1 = leftNode()->Eval(interp);
+        Apply(interp, op1);
         return op1;
     }
+    void Compile(Bytecode& code) {
+        leftNode()->Compile(code);
+        code.Emit(OP_PRINT);
+    }
+};
+
+// the arithmetic operators. the parser builds a+b-c+... as a+(b-(c+...)), so
+// a long expression is a long chain of these down the right. every pass
+// follows that chain in a loop, keeping the operands still waiting for their
+// right hand side on an explicit stack, so the C++ stack does not grow with
+// the length of an expression. the stack is the Interpreter's, shared by
+// every chain: an inner chain (one in a left operand) uses the space above
+// the outer one's and is done with it before the outer one goes on
+class BinaryOp : public ParseNode {
+protected:
+    BinaryOp(ParseNode *l, ParseNode *r) : ParseNode(l,r) {}
+
+    // what this node does with its two values, errors and all. the caller
+    // has no further use for them, so their storage may be reused
+    virtual Value Combine(Interpreter& interp, Value&& op1, Value&& op2) = 0;
+    virtual void EmitOp(Bytecode& code) = 0;
+    // this node's replacement now that its children are folded
+    virtual ParseNode *FoldOp(Interpreter& interp) = 0;
+    // likewise now that its children are specialized, a and b being their
+    // types; sets type to this node's
+    virtual ParseNode *SpecializeOp(Interpreter& interp, StaticType a, StaticType b, StaticType& type) = 0;
+
+    // 1 for +, -1 for -, 0 for the other operators
+    virtual int sumSign() { return 0; }
+    // chain, folded, as a SumNode if it starts with two or more + and -
+    static ParseNode *fuseSum(Interpreter& interp, ParseNode *chain);
+    // which gives the chain back when it is specialized
+    friend class SumNode;
+
+public:
+    BinaryOp *AsBinary() { return this; }
+
+    void RunStaticChecks(Interpreter& interp) {
+        ParseNode *n = this;
+        for( BinaryOp *b; n && (b = n->AsBinary()) != 0; n = b->rightNode() )
+            if( b->leftNode() ) b->leftNode()->RunStaticChecks(interp);
+        if( n ) n->RunStaticChecks(interp);
+    }
+    void Resolve(Interpreter& interp) {
+        ParseNode *n = this;
+        for( BinaryOp *b; n && (b = n->AsBinary()) != 0; n = b->rightNode() )
+            if( b->leftNode() ) b->leftNode()->Resolve(interp);
+        if( n ) n->Resolve(interp);
+    }
+
+    // the left operands are evaluated top down, then the innermost right
+    // one, then the operators are applied bottom up: the same order as
+    // evaluating the nested nodes recursively
+    Value Eval(Interpreter& interp) {
+        vector<BinaryOp *>& spine = interp.spine;
+        vector<Value>& operands = interp.operands;
+        size_t base = spine.size();
+        ParseNode *n = this;
+        for( BinaryOp *b; n && (b = n->AsBinary()) != 0; n = b->rightNode() ) {
+            spine.push_back(b);
+            Value op1 = b->leftNode()->Eval(interp);
+            operands.push_back(std::move(op1));
+        }
+        Value result = n->Eval(interp);
+        while( spine.size() > base ) {
+            result = spine.back()->Combine(interp, std::move(operands.back()), std::move(result));
+            spine.pop_back();
+            operands.pop_back();
+        }
+        return result;
+    }
+    // Eval with each operator of the chain timed for --stats. rows has one
+    // entry per operator, top down
+    Value EvalProfiled(Interpreter& interp, NodeStats *const *rows) {
+        vector<BinaryOp *>& spine = interp.spine;
+        vector<Value>& operands = interp.operands;
+        size_t base = spine.size();
+        ParseNode *n = this;
+        for( BinaryOp *b; n && (b = n->AsBinary()) != 0; n = b->rightNode() ) {
+            interp.stats.Enter(*rows++);
+            spine.push_back(b);
+            Value op1 = b->leftNode()->Eval(interp);
+            operands.push_back(std::move(op1));
+        }
+        Value result = n->Eval(interp);
+        while( spine.size() > base ) {
+            result = spine.back()->Combine(interp, std::move(operands.back()), std::move(result));
+            spine.pop_back();
+            operands.pop_back();
+            interp.stats.Leave();
+        }
+        return result;
+    }
+    // the operands are wrapped, but not the operators, so the chain can
+    // still be walked
+    void Instrument(Interpreter& interp) {
+        ParseNode *n = this;
+        BinaryOp *b = 0;
+        for( BinaryOp *next; n && (next = n->AsBinary()) != 0; n = next->rightNode() ) {
+            b = next;
+            if( b->leftNode() ) b->setLeft(Profile(interp, b->leftNode()));
+        }
+        if( n ) b->setRight(Profile(interp, n));
+    }
+    void Compile(Bytecode& code) {
+        vector<BinaryOp *> spine;
+        ParseNode *n = this;
+        for( BinaryOp *b; n && (b = n->AsBinary()) != 0; n = b->rightNode() ) {
+            spine.push_back(b);
+            b->leftNode()->Compile(code);
+        }
+        n->Compile(code);
+        while( !spine.empty() ) {
+            spine.back()->EmitOp(code);
+            spine.pop_back();
+        }
+    }
+    ParseNode *Fold(Interpreter& interp) {
+        vector<BinaryOp *>& spine = interp.spine;
+        size_t base = spine.size();
+        ParseNode *n = this;
+        for( BinaryOp *b; n && (b = n->AsBinary()) != 0; n = b->rightNode() ) {
+            spine.push_back(b);
+            if( b->leftNode() ) b->setLeft(b->leftNode()->Fold(interp));
+        }
+        ParseNode *folded = n ? n->Fold(interp) : 0;
+        while( spine.size() > base ) {
+            BinaryOp *b = spine.back();
+            spine.pop_back();
+            b->setRight(folded);
+            folded = b->FoldOp(interp);
+        }
+        return fuseSum(interp, folded);
+    }
+    ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        vector<BinaryOp *>& spine = interp.spine;
+        vector<StaticType>& lefts = interp.operandTypes;
+        size_t base = spine.size();
+        ParseNode *n = this;
+        for( BinaryOp *b; n && (b = n->AsBinary()) != 0; n = b->rightNode() ) {
+            StaticType t;
+            if( b->leftNode() ) b->setLeft(b->leftNode()->Specialize(interp, t));
+            spine.push_back(b);
+            lefts.push_back(t);
+        }
+        type = StaticType();
+        ParseNode *specialized = n ? n->Specialize(interp, type) : 0;
+        while( spine.size() > base ) {
+            BinaryOp *b = spine.back();
+            b->setRight(specialized);
+            // an operator missing an operand is left for Eval to report
+            if( b->leftNode() && specialized )
+                specialized = b->SpecializeOp(interp, lefts.back(), type, type);
+            else {
+                specialized = b;
+                type = StaticType();
+            }
+            spine.pop_back();
+            lefts.pop_back();
+        }
+        return specialized;
+    }
+    void Dump(ostream& out, int depth) {
+        ParseNode *n = this;
+        for( BinaryOp *b; n && (b = n->AsBinary()) != 0; n = b->rightNode(), depth++ ) {
+            out << string(2 * depth, ' ') << b->Describe() << "\n";
+            if( b->leftNode() ) b->leftNode()->Dump(out, depth + 1);
+        }
+        if( n ) n->Dump(out, depth);
+    }
 };
 
 // represents adding
-class PlusOp : public ParseNode {
+class PlusOp : public BinaryOp {
+protected:
+    Value Combine(Interpreter& interp, Value&& op1, Value&& op2) { return Apply(interp, std::move(op1), std::move(op2)); }
+    void EmitOp(Bytecode& code) { code.Emit(OP_ADD); }
+    ParseNode *FoldOp(Interpreter& interp) {
+        ParseNode *c = FoldConstants(interp, leftNode(), rightNode(), &Value::operator+);
+        return c ? c : this;
+    }
+    ParseNode *SpecializeOp(Interpreter& interp, StaticType a, StaticType b, StaticType& type);
+    int sumSign() { return 1; }
 public:
-	PlusOp(ParseNode *l, ParseNode *r) : ParseNode(l,r) {}
-    Value Eval(map<string,Value>& symb) {
-        Value op1 = leftNode()->Eval(symb);
-        Value op2 = rightNode()->Eval(symb);
-        Value sum = op1 + op2;
+	PlusOp(ParseNode *l, ParseNode *r) : BinaryOp(l,r) {}
+    string Describe() { return "Plus"; }
+    bool Signature(string& sig) { sig += '+'; return true; }
+    static Value Apply(Interpreter& interp, const Value& op1, const Value& op2) {
+        return Checked(interp, op1 + op2);
+    }
+    // the same for operands the caller is done with
+    static Value Apply(Interpreter& interp, Value&& op1, Value&& op2) {
+        return Checked(interp, Value::Add(std::move(op1), std::move(op2)));
+    }
+    static Value Checked(Interpreter& interp, Value sum) {
         if( sum.GetType() == UNKNOWNVAL ) {
-            runtimeError("type mismatch in add");
+            interp.RuntimeError("type mismatch in add");
         }
         return sum;
     }
 };
 
 // represents subtracting
-class MinusOp : public ParseNode {
+class MinusOp : public BinaryOp {
+protected:
+    Value Combine(Interpreter& interp, Value&& op1, Value&& op2) { return Apply(interp, std::move(op1), std::move(op2)); }
+    void EmitOp(Bytecode& code) { code.Emit(OP_SUB); }
+    ParseNode *FoldOp(Interpreter& interp) {
+        ParseNode *c = FoldConstants(interp, leftNode(), rightNode(), &Value::operator-);
+        return c ? c : this;
+    }
+    ParseNode *SpecializeOp(Interpreter& interp, StaticType a, StaticType b, StaticType& type);
+    int sumSign() { return -1; }
 public:
-    MinusOp(ParseNode *l, ParseNode *r) : ParseNode(l,r) {}
-    Value Eval(map<string,Value>& symb) {
-        Value op1 = leftNode()->Eval(symb);
-        Value op2 = rightNode()->Eval(symb);
-        Value sum = op1 - op2;
-        if( sum.GetType() == UNKNOWNVAL ) {
-            runtimeError("type mismatch in subtract");
+    MinusOp(ParseNode *l, ParseNode *r) : BinaryOp(l,r) {}
+    string Describe() { return "Minus"; }
+    bool Signature(string& sig) { sig += '-'; return true; }
+    static Value Apply(Interpreter& interp, const Value& op1, const Value& op2) {
+        return Checked(interp, op1 - op2);
+    }
+    // the same for operands the caller is done with
+    static Value Apply(Interpreter& interp, Value&& op1, Value&& op2) {
+        return Checked(interp, Value::Subtract(std::move(op1), std::move(op2)));
+    }
+    static Value Checked(Interpreter& interp, Value difference) {
+        if( difference.GetType() == UNKNOWNVAL ) {
+            interp.RuntimeError("type mismatch in subtract");
+        }
+        return difference;
+    }
+};
+
+// t0 + t1 - t2 + ... as a whole, which Fold makes of a chain of two or more
+// additions and subtractions: the parser's t0 + (t1 - (t2 + ...)), its
+// operators still grouped from the right. when every term is a polynomial
+// the sum is made in one block by Value::SumPolys, rather than in a block
+// for each operator. otherwise the operators are applied one at a time from
+// the right, as the chain would, so every error is reported as it was
+class SumNode : public ParseNode {
+    BinaryOp	*chain;		// the chain it was made from
+    unsigned	n;			// terms
+    ParseNode	**terms;
+    int			*signs;		// 1 or -1 for the operator after each term
+public:
+    // terms and signs are in the arena, as the node is
+    SumNode(BinaryOp *chain, unsigned n, ParseNode **terms, int *signs)
+        : ParseNode(), chain(chain), n(n), terms(terms), signs(signs) {}
+
+    // the n terms, evaluated, with signs[k] for the operator after terms[k].
+    // the caller has no further use for them
+    static Value Apply(Interpreter& interp, Value *terms, const int *signs, unsigned n) {
+        for( unsigned k = 0; k < n; k++ ) {
+            if( terms[k].GetType() == POLYVAL )
+                continue;
+            Value sum = std::move(terms[n-1]);
+            for( unsigned j = n - 1; j-- > 0; )
+                sum = signs[j] > 0 ? PlusOp::Apply(interp, std::move(terms[j]), std::move(sum))
+                    : MinusOp::Apply(interp, std::move(terms[j]), std::move(sum));
+            return sum;
+        }
+        return Value::SumPolys(terms, signs, n);
+    }
+    Value Eval(Interpreter& interp) {
+        vector<Value>& operands = interp.operands;
+        size_t base = operands.size();
+        for( unsigned k = 0; k < n; k++ ) {
+            Value v = terms[k]->Eval(interp);
+            operands.push_back(std::move(v));
         }
+        Value sum = Apply(interp, &operands[base], signs, n);
+        operands.resize(base);
         return sum;
     }
+    void Compile(Bytecode& code) {
+        for( unsigned k = 0; k < n; k++ )
+            terms[k]->Compile(code);
+        Value list = Value::List(n - 1, false);
+        for( unsigned k = 0; k < n - 1; k++ )
+            list.PolyInts()[k] = signs[k];
+        code.Emit(OP_SUM, code.AddConstant(list));
+    }
+    // a sum with a term known not to be a polynomial might have variants for
+    // its operators, so it goes back to being the chain, each operator given
+    // the types of its operands as BinaryOp::Specialize would. any other
+    // stays a sum, a polynomial if every term is known to be one
+    ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        vector<StaticType>& types = interp.operandTypes;
+        size_t base = types.size();
+        bool polys = true;
+        bool other = false;
+        bool isFloat = false;
+        for( unsigned k = 0; k < n; k++ ) {
+            StaticType t;
+            terms[k] = terms[k]->Specialize(interp, t);
+            types.push_back(t);
+            polys = polys && t.t == POLYVAL;
+            other = other || (t.Known() && t.t != POLYVAL);
+            isFloat = isFloat || t.isFloat;
+        }
+        if( !other ) {
+            types.resize(base);
+            type = polys ? StaticType(POLYVAL, isFloat) : StaticType();
+            return this;
+        }
+        // the operators still link up as they did
+        vector<BinaryOp *>& spine = interp.spine;
+        size_t ops = spine.size();
+        for( BinaryOp *b = chain; spine.size() - ops < n - 1; b = b->rightNode()->AsBinary() )
+            spine.push_back(b);
+        ParseNode *specialized = terms[n-1];
+        type = types.back();
+        for( unsigned j = n - 1; j-- > 0; ) {
+            BinaryOp *b = spine[ops + j];
+            b->setLeft(terms[j]);
+            b->setRight(specialized);
+            specialized = b->SpecializeOp(interp, types[base + j], type, type);
+        }
+        spine.resize(ops);
+        types.resize(base);
+        return specialized;
+    }
+    void Instrument(Interpreter& interp) {
+        for( unsigned k = 0; k < n; k++ )
+            terms[k] = Profile(interp, terms[k]);
+    }
+    void ChildSlots(vector<ParseNode **>& slots) {
+        for( unsigned k = 0; k < n; k++ )
+            slots.push_back(&terms[k]);
+    }
+    bool Signature(string& sig) {
+        sig += 'S';
+        for( unsigned k = 0; k < n - 1; k++ )
+            sig += signs[k] > 0 ? '+' : '-';
+        return true;
+    }
+    int getLine() { return chain->getLine(); }
+    string Describe() {
+        string d = "Sum";
+        for( unsigned k = 0; k < n - 1; k++ )
+            d += signs[k] > 0 ? " +" : " -";
+        return d;
+    }
+    void Dump(ostream& out, int depth) {
+        out << string(2 * depth, ' ') << Describe() << "\n";
+        for( unsigned k = 0; k < n; k++ )
+            terms[k]->Dump(out, depth + 1);
+    }
 };
 
 // represents multiplying the two child expressions
-class TimesOp : public ParseNode {
+class TimesOp : public BinaryOp {
+protected:
+    Value Combine(Interpreter& interp, Value&& op1, Value&& op2) { return Apply(interp, op1, op2); }
+    void EmitOp(Bytecode& code) { code.Emit(OP_MUL); }
+    ParseNode *FoldOp(Interpreter& interp);
+    ParseNode *SpecializeOp(Interpreter& interp, StaticType a, StaticType b, StaticType& type);
 public:
-	TimesOp(ParseNode *l, ParseNode *r) : ParseNode(l,r) {}
-    Value Eval(map<string,Value>& symb) {
-        Value op1 = leftNode()->Eval(symb);
-        Value op2 = rightNode()->Eval(symb);
+	TimesOp(ParseNode *l, ParseNode *r) : BinaryOp(l,r) {}
+    string Describe() { return "Times"; }
+    bool Signature(string& sig) { sig += '*'; return true; }
+    static Value Apply(Interpreter& interp, const Value& op1, const Value& op2) {
         Value product = op1 * op2;
         if( product.GetType() == UNKNOWNVAL ) {
-            runtimeError("type mismatch in multiply");
+            interp.RuntimeError("type mismatch in multiply");
         }
         return product;
     }
 };
 
+// kernels for operands whose types SpecializeTypes has settled, so they need
+// no checking. each does exactly what Value's operator does for those types
+template<class T> struct ScalarType;
+template<> struct ScalarType<int> {
+    static Type Tag() { return INTEGERVAL; }
+    static const char *Name() { return "int"; }
+    static int Of(const Value& v) { return v.AsInt(); }
+    static const int *Coefficients(const Value& v) { return v.PolyInts(); }
+};
+template<> struct ScalarType<float> {
+    static Type Tag() { return FLOATVAL; }
+    static const char *Name() { return "float"; }
+    static float Of(const Value& v) { return v.AsFloat(); }
+    static const float *Coefficients(const Value& v) { return v.PolyFloats(); }
+};
+
+// the operators. Opcode gives the instruction for operands that are both of
+// type t, the generic one unless the VM has its own
+struct Add {
+    template<class A, class B> static auto Do(A a, B b) -> decltype(a + b) { return a + b; }
+    static Value IntPolys(const Value& a, const Value& b) { return Value::AddIntPolys(a, b); }
+    static OpCode Opcode(Type t) { return t == INTEGERVAL ? OP_ADD_INT : t == FLOATVAL ? OP_ADD_FLOAT : OP_ADD; }
+};
+struct Subtract {
+    template<class A, class B> static auto Do(A a, B b) -> decltype(a - b) { return a - b; }
+    static Value IntPolys(const Value& a, const Value& b) { return Value::SubtractIntPolys(a, b); }
+    static OpCode Opcode(Type t) { return t == INTEGERVAL ? OP_SUB_INT : t == FLOATVAL ? OP_SUB_FLOAT : OP_SUB; }
+};
+struct Multiply {
+    template<class A, class B> static auto Do(A a, B b) -> decltype(a * b) { return a * b; }
+    static Value IntPolys(const Value& a, const Value& b) { return Value::MultiplyIntPolys(a, b); }
+    static OpCode Opcode(Type t) { return t == INTEGERVAL ? OP_MUL_INT : t == FLOATVAL ? OP_MUL_FLOAT : OP_MUL; }
+};
+
+// Op on an A and a B, each an int or a float; mixed operands convert to
+// float as the C++ operators do, which is what Value does too
+template<class Op, class A, class B> struct Scalars {
+    static Value Apply(const Value& a, const Value& b) { return Value(Op::Do(ScalarType<A>::Of(a), ScalarType<B>::Of(b))); }
+    static OpCode Opcode() { return Op::Opcode(std::is_same<A,B>::value ? ScalarType<A>::Tag() : UNKNOWNVAL); }
+    static string Name() { return string(ScalarType<A>::Name()) + "," + ScalarType<B>::Name(); }
+};
+
+// Op on two int polynomials
+template<class Op> struct IntPolys {
+    static Value Apply(const Value& a, const Value& b) { return Op::IntPolys(a, b); }
+    static OpCode Opcode() { return Op::Opcode(POLYVAL); }
+    static string Name() { return "int poly,int poly"; }
+};
+
+// the operator G for operands whose types are known, doing Kernel with no
+// checks and so no error path. it is still a BinaryOp, so a chain of them
+// is walked like any other
+template<class G, class Kernel>
+class Typed : public G {
+protected:
+    Value Combine(Interpreter& interp, Value&& op1, Value&& op2) { return Kernel::Apply(op1, op2); }
+    void EmitOp(Bytecode& code) { code.Emit(Kernel::Opcode()); }
+public:
+    Typed(ParseNode *l, ParseNode *r) : G(l, r) {}
+    string Describe() { return G::Describe() + " " + Kernel::Name(); }
+    // apart from G's, since the same operands in another statement may be
+    // of other types
+    bool Signature(string& sig) {
+        G::Signature(sig);
+        sig += Kernel::Name();
+        return true;
+    }
+};
+
+// c1 * (c2 * ( ... * (cn * x))) for int literals c1..cn, as the parser builds
+// 2*2*2*2*z. when x is an int or an int polynomial, wrapping arithmetic makes
+// that the same as (c1 c2 ... cn) * x, so the product is taken once at fold
+// time. anything else is multiplied out one factor at a time as before, which
+// keeps float rounding and error messages exactly as they were
+class FoldedProduct : public ParseNode {
+    vector<int> factors;	// c1 .. cn
+    int product;
+public:
+    FoldedProduct(const vector<int>& factors, ParseNode *x) : ParseNode(x), factors(factors) {
+        unsigned p = 1;
+        for( unsigned i = 0; i < factors.size(); i++ )
+            p *= (unsigned)factors[i];
+        product = (int)p;
+    }
+    const vector<int>& Factors() { return factors; }
+
+    static Value Apply(Interpreter& interp, const int *factors, unsigned n, int product, const Value& x) {
+        if( x.GetType() == INTEGERVAL || (x.GetType() == POLYVAL && !x.PolyIsFloat()) )
+            return Value(product) * x;
+        Value v = x;
+        for( unsigned i = n; i-- > 0; )
+            v = TimesOp::Apply(interp, Value(factors[i]), v);
+        return v;
+    }
+    Value Eval(Interpreter& interp) {
+        Value x = leftNode()->Eval(interp);
+        return Apply(interp, factors.data(), (unsigned)factors.size(), product, x);
+    }
+    // each factor is an int, which keeps the type of any x it can multiply
+    ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        setLeft(leftNode()->Specialize(interp, type));
+        if( type.t != INTEGERVAL && type.t != FLOATVAL && type.t != POLYVAL )
+            type = StaticType();
+        return this;
+    }
+    void Compile(Bytecode& code) {
+        leftNode()->Compile(code);
+        Value list = Value::List((unsigned)factors.size(), false);
+        for( unsigned i = 0; i < factors.size(); i++ )
+            list.PolyInts()[i] = factors[i];
+        int k = code.AddConstant(Value(product));
+        code.AddConstant(list);
+        code.Emit(OP_MUL_FOLDED, k);
+    }
+    bool Signature(string& sig) {
+        sig += 'F';
+        sig.append((const char *)factors.data(), factors.size() * sizeof(int));
+        return true;
+    }
+    string Describe() {
+        ostringstream out;
+        out << "FoldedProduct " << product << " =";
+        for( unsigned i = 0; i < factors.size(); i++ )
+            out << (i ? " * " : " ") << factors[i];
+        return out.str();
+    }
+};
+
 
 // a representation of a list of coefficients must be developed
 class Coefficients : public ParseNode {
@@ -421,26 +866,124 @@ public:
         
     }
     
-    Value Eval(map<string,Value>& symb) {
-        vector<Value *> l =  vector<Value *>();
-        vector<ParseNode *>::iterator It;
-        int i =0;
-        ParseNode* thing;
-        for(It = coefficients.begin(); It != coefficients.end(); It++)
-        {
-            thing = *It;
-            
-            
-            l.push_back(new Value(thing->Eval(symb)));
-            
-            i++;
-        }
-        return Value(l);
+    // the polynomial the literals spell out
+    Value Make();
+
+    Value Eval(Interpreter& interp) {
+        return Make();
+    }
+    // the coefficients are all literals, so the polynomial is a constant
+    void Compile(Bytecode& code) {
+        code.Emit(OP_PUSH_CONST, code.AddConstant(Make()));
+    }
+    ParseNode *Fold(Interpreter& interp) {
+        return interp.New<Constant>(Make());
+    }
+    // the literals are read directly, never evaluated
+    void Instrument(Interpreter& interp) {}
+    string Describe() { return "Coefficients"; }
+    void Dump(ostream& out, int depth) {
+        ParseNode::Dump(out, depth);
+        for( unsigned i = 0; i < coefficients.size(); i++ )
+            coefficients[i]->Dump(out, depth + 1);
     }
 };
 
 
 
+// the points inside p[[x1, x2, ...]]. each one is an expression; together
+// they evaluate to a list
+class PointList : public ParseNode {
+    vector<ParseNode *> points;
+public:
+    PointList(vector<ParseNode *> &pts) : ParseNode(), points(pts) {}
+
+    void RunStaticChecks(Interpreter& interp) {
+        for( unsigned i = 0; i < points.size(); i++ )
+            points[i]->RunStaticChecks(interp);
+    }
+    void Resolve(Interpreter& interp) {
+        for( unsigned i = 0; i < points.size(); i++ )
+            points[i]->Resolve(interp);
+    }
+
+    // a list of n numbers, float if any of them is
+    static Value Apply(Interpreter& interp, const Value *pts, unsigned n) {
+        bool isFloat = false;
+        for( unsigned i = 0; i < n; i++ ) {
+            if( pts[i].GetType() == FLOATVAL )
+                isFloat = true;
+            else if( pts[i].GetType() != INTEGERVAL ) {
+                interp.RuntimeError("type mismatch");
+                return Value();
+            }
+        }
+
+        Value list = Value::List(n, isFloat);
+        for( unsigned i = 0; i < n; i++ ) {
+            if( isFloat )
+                list.PolyFloats()[i] = pts[i].GetType() == FLOATVAL ? pts[i].GetFloatValue() : (float)pts[i].GetIntValue();
+            else
+                list.PolyInts()[i] = pts[i].GetIntValue();
+        }
+        return list;
+    }
+    Value Eval(Interpreter& interp) {
+        vector<Value> vals;
+        vals.reserve(points.size());
+        for( unsigned i = 0; i < points.size(); i++ )
+            vals.push_back(points[i]->Eval(interp));
+        return Apply(interp, vals.data(), (unsigned)vals.size());
+    }
+    void Compile(Bytecode& code) {
+        for( unsigned i = 0; i < points.size(); i++ )
+            points[i]->Compile(code);
+        code.Emit(OP_MAKE_LIST, (int)points.size());
+    }
+    // constant when every point is a constant number
+    ParseNode *Fold(Interpreter& interp) {
+        vector<Value> vals;
+        for( unsigned i = 0; i < points.size(); i++ ) {
+            points[i] = points[i]->Fold(interp);
+            const Value *v = points[i]->ConstantValue();
+            if( v && (v->GetType() == INTEGERVAL || v->GetType() == FLOATVAL) )
+                vals.push_back(*v);
+        }
+        if( vals.size() != points.size() )
+            return this;
+        return interp.New<Constant>(Apply(interp, vals.data(), (unsigned)vals.size()));
+    }
+    ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        bool known = true;
+        bool isFloat = false;
+        for( unsigned i = 0; i < points.size(); i++ ) {
+            StaticType t;
+            points[i] = points[i]->Specialize(interp, t);
+            if( t.t == FLOATVAL )
+                isFloat = true;
+            else if( t.t != INTEGERVAL )
+                known = false;
+        }
+        type = known ? StaticType(LISTVAL, isFloat) : StaticType();
+        return this;
+    }
+    void Instrument(Interpreter& interp) {
+        for( unsigned i = 0; i < points.size(); i++ )
+            points[i] = Profile(interp, points[i]);
+    }
+    bool Signature(string& sig) { sig += 'L'; return true; }
+    void ChildSlots(vector<ParseNode **>& slots) {
+        for( unsigned i = 0; i < points.size(); i++ )
+            slots.push_back(&points[i]);
+    }
+    string Describe() { return "PointList"; }
+    void Dump(ostream& out, int depth) {
+        ParseNode::Dump(out, depth);
+        for( unsigned i = 0; i < points.size(); i++ )
+            points[i]->Dump(out, depth + 1);
+    }
+};
+
 // leaves of the parse tree
 // notice that the parent constructors take no arguments
 // that means this is a leaf
@@ -451,9 +994,18 @@ public:
     int GetIntValue(){
         return iValue;
     }
-    Value Eval(map<string,Value>& symb) {
+    Value Eval(Interpreter& interp) {
         return Value(iValue);
     }
+    void Compile(Bytecode& code) {
+        code.Emit(OP_PUSH_CONST, code.AddConstant(Value(iValue)));
+    }
+    ParseNode *Fold(Interpreter& interp) { return interp.New<Constant>(Value(iValue)); }
+    string Describe() {
+        ostringstream out;
+        out << "Iconst " << iValue;
+        return out.str();
+    }
     Type GetType() { return INTEGERVAL; }
 };
 
@@ -462,8 +1014,17 @@ class Fconst : public ParseNode {
 public:
 	Fconst(float fValue) : fValue(fValue), ParseNode() {}
     float GetFloatValue(){ return fValue;}
-    Value Eval(map<string,Value>& symb) {
+    Value Eval(Interpreter& interp) {
         return Value(fValue);
+    }
+    void Compile(Bytecode& code) {
+        code.Emit(OP_PUSH_CONST, code.AddConstant(Value(fValue)));
+    }
+    ParseNode *Fold(Interpreter& interp) { return interp.New<Constant>(Value(fValue)); }
+    string Describe() {
+        ostringstream out;
+        out << "Fconst " << fValue;
+        return out.str();
     }
 	Type GetType() { return FLOATVAL; }
 };
@@ -473,29 +1034,57 @@ class Sconst : public ParseNode {
 public:
 	Sconst(string sValue) : sValue(sValue), ParseNode() {}
     string GetStringValue(){ return sValue; }
-    Value Eval(map<string,Value>& symb) {
+    Value Eval(Interpreter& interp) {
         return Value(sValue);
     }
+    void Compile(Bytecode& code) {
+        code.Emit(OP_PUSH_CONST, code.AddConstant(Value(sValue)));
+    }
+    ParseNode *Fold(Interpreter& interp) { return interp.New<Constant>(Value(sValue)); }
+    string Describe() { return "Sconst \"" + sValue + "\""; }
 	Type GetType() { return STRINGVAL; }
 };
 
 
 class Ident : public ParseNode {
 	string	id;
+    int slot;
     Type t;
+    bool last;		// moves the value out of its slot
 public:
-	Ident(string id) : id(id), t(UNKNOWNVAL), ParseNode() {}
-    void RunStaticChecks(map<string,bool>& idMap) {
-        if( idMap[id] == false ) {
-            runtimeError("identifier " + id + " used before set");
-            ++globalErrorCount;
+	Ident(string id) : ParseNode(), id(id), slot(-1), t(UNKNOWNVAL), last(false) {}
+    void RunStaticChecks(Interpreter& interp) {
+        slot = interp.symbols.Slot(id);
+        if( interp.symbols.IsSet(slot) == false ) {
+            interp.RuntimeError("identifier " + id + " used before set");
+            ++interp.errorCount;
         }
     }
-    Value Eval(map<string,Value>& symb) {
-        t = symb[id].GetType();
-        return symb[id];
+    void Resolve(Interpreter& interp) {
+        slot = interp.symbols.Slot(id);
+    }
+    Value Eval(Interpreter& interp) {
+        if( last )
+            return std::move(interp.values[slot]);
+        return interp.values[slot];
     }
-    Type GetType() { return t; }; // not known until run time!
+    ParseNode *Specialize(Interpreter& interp, StaticType& type) {
+        type = slot >= 0 && slot < (int)interp.types.size() ? interp.types[slot] : StaticType();
+        t = type.t;
+        return this;
+    }
+    void Compile(Bytecode& code) {
+        code.Emit(last ? OP_MOVE_SLOT : OP_LOAD_SLOT, slot);
+    }
+    string Describe() { return "Ident " + id; }
+    bool Signature(string& sig) {
+        sig += last ? 'M' : 'I';
+        sig.append((const char *)&slot, sizeof slot);
+        return true;
+    }
+    int ReadsSlot() { return slot; }
+    void LastRead() { last = true; }
+    Type GetType() { return t; }; // UNKNOWNVAL unless SpecializeTypes settled it
 };
 
 // represents evaluating a polynomial
@@ -504,83 +1093,265 @@ public:
     EvaluateAt(ParseNode *l, ParseNode *r) : ParseNode(l,r) {}
 
     
-    Value Eval(map<string,Value>& symb) {
-        Value op1 = leftNode()->Eval(symb);
-        Value op2 = rightNode()->Eval(symb);
-        
+    Value Eval(Interpreter& interp) {
+        Value op1 = leftNode()->Eval(interp);
+        Value op2 = rightNode()->Eval(interp);
+        int slot = leftNode()->ReadsSlot();
+        if( slot >= 0 )
+            return ApplySlot(interp, slot, op1, op2);
+        return Apply(interp, op1, op2);
+    }
+    void Compile(Bytecode& code) {
+        int slot = leftNode()->ReadsSlot();
+        if( slot >= 0 ) {
+            rightNode()->Compile(code);
+            code.Emit(OP_EVAL_AT_SLOT, slot);
+            return;
+        }
+        leftNode()->Compile(code);
+        rightNode()->Compile(code);
+        code.Emit(OP_EVAL_AT);
+    }
+    // only folds when Apply cannot fail
+    ParseNode *Fold(Interpreter& interp) {
+        ParseNode::Fold(interp);
+        const Value *p = leftNode()->ConstantValue();
+        const Value *x = rightNode()->ConstantValue();
+        if( p == 0 || x == 0 || p->GetType() != POLYVAL )
+            return this;
+        if( x->GetType() != INTEGERVAL && x->GetType() != FLOATVAL && x->GetType() != LISTVAL )
+            return this;
+        return interp.New<Constant>(Apply(interp, *p, *x));
+    }
+    ParseNode *Specialize(Interpreter& interp, StaticType& type);
+    string Describe() { return "EvaluateAt"; }
+    bool Signature(string& sig) { sig += '@'; return true; }
+
+    static Value Apply(Interpreter& interp, const Value& op1, const Value& op2) {
         if( op1.GetType() != POLYVAL ) {
-            runtimeError( "type mismatch in EvaluateAt");
+            interp.RuntimeError("type mismatch in EvaluateAt");
+            return Value();
         }
         
-        if(op2.GetType()!=FLOATVAL || op2.GetType()!=INTEGERVAL){
-            runtimeError( "type mismatch");
+        if( op2.GetType() == LISTVAL )
+            return ApplyMany(op1, op2);
+        if( op2.GetType() != FLOATVAL && op2.GetType() != INTEGERVAL ){
+            interp.RuntimeError("type mismatch");
             return Value();
         }
         
-        vector<Value *> temp = op1.GetPolyValue();
-        
-        bool isFloat = false;
-        if(op2.GetType() == FLOATVAL){
-            isFloat = true;
+        if( op2.GetType() == FLOATVAL ) {
+            if( op1.PolyIsFloat() )
+                return Value(Evaluate(op1, op1.PolyFloats(), op2.GetFloatValue()));
+            return Value(Evaluate(op1, op1.PolyInts(), op2.GetFloatValue()));
         }
-        for(int i = 0; i < temp.size(); i++){
-            if(isFloat) break;
-            if(temp[i]->GetType() == FLOATVAL){
-                isFloat = true;
-            }
+        if( op1.PolyIsFloat() )
+            return Value(Evaluate(op1, op1.PolyFloats(), (float) op2.GetIntValue()));
+        return Value(Evaluate(op1, op1.PolyInts(), op2.GetIntValue()));
+    }
+
+    // p, whose coefficients are c, at the single point x. one held inline
+    // is short enough for the unrolled kernel
+    template<class C, class X> static X Evaluate(const Value& p, const C *c, X x) {
+        static_assert(Value::InlineTerms <= 8, "PolyEvaluateSmall takes at most 8 terms");
+        return p.PolyInline() ? PolyEvaluateSmall(c, p.PolySize(), x) : PolyEvaluate(c, p.PolySize(), x);
+    }
+
+    // Apply for p, the value of the variable in slot, going through the
+    // cache when p is long enough to be worth it and x is a single point
+    static Value ApplySlot(Interpreter& interp, int slot, const Value& p, const Value& x) {
+        EvalCache& cache = interp.evalCache;
+        if( !cache.Enabled() || p.GetType() != POLYVAL || p.PolySize() < EvalCache::MinTerms
+                || (x.GetType() != INTEGERVAL && x.GetType() != FLOATVAL) )
+            return Apply(interp, p, x);
+        unsigned version = interp.versions[slot];
+        Value r;
+        if( cache.Find(slot, version, x, r) )
+            return r;
+        r = Apply(interp, p, x);
+        cache.Insert(slot, version, x, r);
+        return r;
+    }
+
+    // p at every point of a list, in one batched call over the flat
+    // coefficient and point arrays
+    static Value ApplyMany(const Value& op1, const Value& op2) {
+        unsigned n = op1.PolySize();
+        unsigned m = op2.PolySize();
+        if( !op1.PolyIsFloat() && !op2.PolyIsFloat() ) {
+            Value r = Value::List(m, false);
+            PolyEvaluate(op1.PolyInts(), n, op2.PolyInts(), r.PolyInts(), m);
+            return r;
         }
-        
-        
-        if(isFloat){
-            float j = (float) temp.size() - 1;
-            float val;
-            float val2;
-            float sum = 0.0;
-            for(int i = 0; i < temp.size(); i++){
-                
-                if(temp[i]->GetType()== FLOATVAL){
-                    val = temp[i]->GetFloatValue();
-                } else {
-                    val = (float) temp[i]->GetIntValue();
-                }
-                    
-                if(op2.GetType() == FLOATVAL){
-                    val2 = op2.GetFloatValue();
-                }else {
-                    val2 = (float) op2.GetIntValue();
-                }
-                sum += pow(val2, j) * val;
-                j--;
-            }
-            return Value(sum);
-        }else {
-            int j = (int) temp.size() - 1;
-            int val;
-            int val2;
-            int sum = 0;
-            for(int i = 0; i < temp.size(); i++){
-                val = temp[i]->GetIntValue();
-                val2 = op2.GetIntValue();
-                sum += pow(val2, j) * val;
-                j--;
-            }
-            return Value(sum);
+
+        vector<float> coeffs, pts;
+        const float *c = op1.PolyFloats();
+        const float *x = op2.PolyFloats();
+        if( !op1.PolyIsFloat() ) {
+            coeffs.assign(op1.PolyInts(), op1.PolyInts() + n);
+            c = coeffs.data();
         }
-        
-        
-        return op1;
+        if( !op2.PolyIsFloat() ) {
+            pts.assign(op2.PolyInts(), op2.PolyInts() + m);
+            x = pts.data();
+        }
+        Value r = Value::List(m, true);
+        PolyEvaluate(c, n, x, r.PolyFloats(), m);
+        return r;
+    }
+};
+
+// EvaluateAt for a polynomial with coefficients of type C at a point of type
+// X, both known: no checks, straight to the kernel. a long polynomial in a
+// variable still goes through the cache
+template<class C, class X>
+class TypedEvaluateAt : public EvaluateAt {
+    // what the kernel works in: int only when both are
+    typedef typename std::conditional<std::is_same<C,int>::value && std::is_same<X,int>::value, int, float>::type P;
+    int slot;
+public:
+    TypedEvaluateAt(ParseNode *l, ParseNode *r) : EvaluateAt(l, r), slot(l->ReadsSlot()) {}
+    Value Eval(Interpreter& interp) {
+        Value p = leftNode()->Eval(interp);
+        Value x = rightNode()->Eval(interp);
+        if( slot >= 0 && p.PolySize() >= EvalCache::MinTerms )
+            return ApplySlot(interp, slot, p, x);
+        return Value(Evaluate(p, ScalarType<C>::Coefficients(p), (P)ScalarType<X>::Of(x)));
+    }
+    static string Name() { return string(ScalarType<C>::Name()) + " poly," + ScalarType<X>::Name(); }
+    string Describe() { return "EvaluateAt " + Name(); }
+    bool Signature(string& sig) {
+        sig += '@';
+        sig += Name();
+        return true;
+    }
+};
+
+// a subexpression that ShareSubtrees found more than once. it is evaluated
+// once and the value reused until one of the variables it reads is set
+// again. a value whose evaluation reported an error is never kept, so every
+// use reports the error just as it would have. one whose variables keep
+// changing under it stops keeping its value, as copying it in is then only
+// extra work
+class SharedExpr : public ParseNode {
+    ParseNode			*node;
+    vector<int>			reads;		// the slots it depends on
+    vector<unsigned>	seen;		// their versions when value was taken
+    Value				value;
+    bool				valid;
+    unsigned			hits;
+    unsigned			misses;
+public:
+    SharedExpr(ParseNode *node, const vector<int>& reads) : ParseNode(), node(node), reads(reads),
+        seen(reads.size()), valid(false), hits(0), misses(0) {}
+    Value Eval(Interpreter& interp) {
+        for( unsigned i = 0; valid && i < reads.size(); i++ )
+            valid = interp.versions[reads[i]] == seen[i];
+        if( valid ) {
+            ++hits;
+            return value;
+        }
+        if( ++misses > 16 && misses > 4 * hits )
+            return node->Eval(interp);
+        int errors = interp.errorCount;
+        Value v = node->Eval(interp);
+        if( interp.errorCount == errors && v.GetType() != UNKNOWNVAL ) {
+            v.Keep();
+            value = v;
+            for( unsigned i = 0; i < reads.size(); i++ )
+                seen[i] = interp.versions[reads[i]];
+            valid = true;
+        }
+        return v;
     }
+    void Compile(Bytecode& code) { node->Compile(code); }
+    int getLine() { return node->getLine(); }
+    Type GetType() { return node->GetType(); }
+    string Describe() { return "Shared"; }
+    void Dump(ostream& out, int depth) {
+        out << string(2 * depth, ' ') << Describe() << "\n";
+        node->Dump(out, depth + 1);
+    }
+};
+
+// what ShareSubtrees did to a program
+struct ShareReport {
+    unsigned long	nodes;		// in the tree before
+    unsigned long	removed;	// copies dropped for the one kept
+    unsigned long	shared;		// subexpressions now evaluated once
+    ShareReport() : nodes(0), removed(0), shared(0) {}
+};
+
+// hash-cons the expressions of program, a tree after folding, into a DAG:
+// identical subtrees become one node, and each repeated subexpression is
+// wrapped in a SharedExpr so its value is reused
+extern ShareReport ShareSubtrees(Interpreter& interp, ParseNode *program);
+
+// stands in for a node under --stats, timing each evaluation of it. every
+// other pass goes straight to the node
+class Profiled : public ParseNode {
+    ParseNode	*node;
+    NodeStats	*row;
+public:
+    Profiled(ParseNode *node, NodeStats *row) : ParseNode(), node(node), row(row) {}
+    Value Eval(Interpreter& interp) {
+        interp.stats.Enter(row);
+        Value v = node->Eval(interp);
+        interp.stats.Leave();
+        return v;
+    }
+    void Compile(Bytecode& code) { node->Compile(code); }
+    int getLine() { return node->getLine(); }
+    Type GetType() { return node->GetType(); }
+    const Value *ConstantValue() { return node->ConstantValue(); }
+    int ReadsSlot() { return node->ReadsSlot(); }
+    string Describe() { return node->Describe(); }
+    void Dump(ostream& out, int depth) { node->Dump(out, depth); }
+};
+
+// the frame that puts a statement's line at the bottom of its stacks
+class ProfiledStatement : public ParseNode {
+    ParseNode	*stmt;
+    int			line;
+public:
+    ProfiledStatement(ParseNode *stmt, int line) : ParseNode(), stmt(stmt), line(line) {}
+    Value Eval(Interpreter& interp) {
+        interp.stats.EnterLine(line);
+        Value v = stmt->Eval(interp);
+        interp.stats.Leave();
+        return v;
+    }
+    void Compile(Bytecode& code) { stmt->Compile(code); }
+    int getLine() { return stmt->getLine(); }
+    string Describe() { return stmt->Describe(); }
+    void Dump(ostream& out, int depth) { stmt->Dump(out, depth); }
+};
+
+// likewise for a chain of operators, with a row for each one
+class ProfiledChain : public ParseNode {
+    BinaryOp			*chain;
+    vector<NodeStats *>	rows;
+public:
+    ProfiledChain(BinaryOp *chain, const vector<NodeStats *>& rows) : ParseNode(), chain(chain), rows(rows) {}
+    Value Eval(Interpreter& interp) { return chain->EvalProfiled(interp, rows.data()); }
+    void Compile(Bytecode& code) { chain->Compile(code); }
+    int getLine() { return chain->getLine(); }
+    Type GetType() { return chain->GetType(); }
+    string Describe() { return chain->Describe(); }
+    void Dump(ostream& out, int depth) { chain->Dump(out, depth); }
 };
 
 
-extern ParseNode *Prog(istream& in);
-extern ParseNode *Stmt(istream& in);
-extern ParseNode *Expr(istream& in);
-extern ParseNode *Term(istream& in);
-extern ParseNode *Primary(istream& in);
-extern ParseNode *Poly(istream& in);
-extern ParseNode *Coeffs(istream& in);
-extern ParseNode *EvalAt(istream& in);
+extern ParseNode *Prog(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *NextStmt(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *Stmt(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *Expr(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *Term(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *Primary(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *Poly(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *Coeffs(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *EvalAt(Interpreter& interp, SourceBuffer& in);
+extern ParseNode *Points(Interpreter& interp, SourceBuffer& in);
 
 
 #endif /* PARSENODE_H_ */
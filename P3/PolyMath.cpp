@@ -0,0 +1,429 @@
+/*
+ * PolyMath.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <string>
+
+#include "PolyMath.h"
+
+using namespace std;
+
+// set from timing products of random polynomials of equal length at -O2:
+// Karatsuba first wins at about 32 terms and the transforms at about 4096
+static const unsigned KaratsubaThreshold = 32;
+static const unsigned NTTThreshold = 4096;
+
+// the algorithms below are templates over the type they accumulate in. int
+// coefficients are multiplied as uint32_t, which wraps the way int does on
+// every machine we build for without the undefined behavior. float
+// coefficients are accumulated in double and rounded once at the end
+
+// out[0, na + nb - 1) += a * b, term by term
+template<class A> static void schoolbook(const A *a, size_t na, const A *b, size_t nb, A *out) {
+    for( size_t i = 0; i < na; i++ ) {
+        A ai = a[i];
+        for( size_t j = 0; j < nb; j++ )
+            out[i + j] += ai * b[j];
+    }
+}
+
+// scratch space karatsuba needs for operands of length n
+static size_t karatsubaScratch(size_t n) {
+    size_t total = 0;
+    while( n >= KaratsubaThreshold && n >= 2 ) {
+        size_t m = n - n / 2;
+        total += 6 * m;
+        n = m;
+    }
+    return total;
+}
+
+// out[0, 2n - 1) += a * b for two operands of length n. work holds at
+// least karatsubaScratch(n) elements
+template<class A> static void karatsuba(const A *a, const A *b, size_t n, A *out, A *work) {
+    if( n < KaratsubaThreshold || n < 2 ) {
+        schoolbook(a, n, b, n, out);
+        return;
+    }
+
+    // a = a0 + x^h a1, where a0 has h terms and a1 has m >= h
+    size_t h = n / 2;
+    size_t m = n - h;
+    A *sa = work;				// a0 + a1
+    A *sb = sa + m;				// b0 + b1
+    A *z1 = sb + m;				// (a0 + a1)(b0 + b1), 2m - 1 terms
+    A *z = z1 + 2 * m;			// a0 b0 and then a1 b1, 2m - 1 terms
+    A *next = z + 2 * m;
+
+    for( size_t i = 0; i < m; i++ ) {
+        sa[i] = a[h + i] + (i < h ? a[i] : A());
+        sb[i] = b[h + i] + (i < h ? b[i] : A());
+    }
+    fill(z1, z1 + 2 * m, A());
+    karatsuba(sa, sb, m, z1, next);
+
+    // a0 b0 goes in at 0 and comes off the middle term
+    fill(z, z + 2 * m, A());
+    karatsuba(a, b, h, z, next);
+    for( size_t i = 0; i < 2 * h - 1; i++ ) {
+        out[i] += z[i];
+        z1[i] -= z[i];
+    }
+
+    // a1 b1 goes in at 2h and comes off the middle term
+    fill(z, z + 2 * m, A());
+    karatsuba(a + h, b + h, m, z, next);
+    for( size_t i = 0; i < 2 * m - 1; i++ ) {
+        out[2 * h + i] += z[i];
+        z1[i] -= z[i];
+    }
+
+    for( size_t i = 0; i < 2 * m - 1; i++ )
+        out[h + i] += z1[i];
+}
+
+// out[0, na + nb - 1) = a * b, splitting the longer operand into pieces as
+// long as the shorter one so that Karatsuba always sees equal lengths
+template<class A> static void multiplyChunked(const A *a, size_t na, const A *b, size_t nb, A *out) {
+    if( na < nb ) {
+        swap(a, b);
+        swap(na, nb);
+    }
+    fill(out, out + na + nb - 1, A());
+
+    if( nb < KaratsubaThreshold ) {
+        schoolbook(a, na, b, nb, out);
+        return;
+    }
+
+    vector<A> piece(nb), prod(2 * nb), work(karatsubaScratch(nb) + 1);
+    for( size_t off = 0; off < na; off += nb ) {
+        size_t len = min(nb, na - off);
+        copy(a + off, a + off + len, piece.begin());
+        fill(piece.begin() + len, piece.end(), A());
+        fill(prod.begin(), prod.end(), A());
+        karatsuba(&piece[0], b, nb, &prod[0], &work[0]);
+        for( size_t i = 0; i < len + nb - 1; i++ )
+            out[off + i] += prod[i];
+    }
+}
+
+// number theoretic transforms modulo three NTT friendly primes. the exact
+// product of int polynomials with up to 2^22 terms is below half the
+// product of the primes, so it can be rebuilt with the Chinese remainder
+// theorem
+static const size_t maxTransform = size_t(1) << 23;
+
+static uint32_t powMod(uint64_t b, uint64_t e, uint32_t p) {
+    uint64_t r = 1;
+    b %= p;
+    while( e ) {
+        if( e & 1 )
+            r = r * b % p;
+        b = b * b % p;
+        e >>= 1;
+    }
+    return (uint32_t)r;
+}
+
+// in place transform of v (length a power of two) modulo P; 3 generates all
+// three groups. P is a template argument so every % P is by a constant
+template<uint32_t P> static void ntt(vector<uint32_t>& v, bool invert) {
+    size_t n = v.size();
+    for( size_t i = 1, j = 0; i < n; i++ ) {
+        size_t bit = n >> 1;
+        for( ; j & bit; bit >>= 1 )
+            j ^= bit;
+        j ^= bit;
+        if( i < j )
+            swap(v[i], v[j]);
+    }
+    vector<uint32_t> roots(n / 2 + 1);
+    for( size_t len = 2; len <= n; len <<= 1 ) {
+        uint32_t w = powMod(3, (P - 1) / len, P);
+        if( invert )
+            w = powMod(w, P - 2, P);
+        roots[0] = 1;
+        for( size_t k = 1; k < len / 2; k++ )
+            roots[k] = (uint32_t)((uint64_t)roots[k-1] * w % P);
+        for( size_t i = 0; i < n; i += len ) {
+            uint32_t *lo = &v[i];
+            uint32_t *hi = &v[i + len / 2];
+            for( size_t k = 0; k < len / 2; k++ ) {
+                uint32_t x = lo[k];
+                uint32_t y = (uint32_t)((uint64_t)hi[k] * roots[k] % P);
+                lo[k] = x + y >= P ? x + y - P : x + y;
+                hi[k] = x >= y ? x - y : x + P - y;
+            }
+        }
+    }
+    if( invert ) {
+        uint64_t inv = powMod(n, P - 2, P);
+        for( size_t i = 0; i < n; i++ )
+            v[i] = (uint32_t)(v[i] * inv % P);
+    }
+}
+
+// the cyclic product of a and b modulo P, in a transform of length n
+template<uint32_t P> static void residues(const int *a, size_t na, const int *b, size_t nb, size_t n,
+                                          vector<uint32_t>& out) {
+    vector<uint32_t> fb(n, 0);
+    out.assign(n, 0);
+    for( size_t i = 0; i < na; i++ )
+        out[i] = (uint32_t)(((int64_t)a[i] % P + P) % P);
+    for( size_t i = 0; i < nb; i++ )
+        fb[i] = (uint32_t)(((int64_t)b[i] % P + P) % P);
+    ntt<P>(out, false);
+    ntt<P>(fb, false);
+    for( size_t i = 0; i < n; i++ )
+        out[i] = (uint32_t)((uint64_t)out[i] * fb[i] % P);
+    ntt<P>(out, true);
+}
+
+static void multiplyNTT(const int *a, size_t na, const int *b, size_t nb, int *out) {
+    size_t nc = na + nb - 1;
+    size_t n = 1;
+    while( n < nc )
+        n <<= 1;
+
+    const uint32_t P0 = 998244353u, P1 = 167772161u, P2 = 469762049u;
+    vector<uint32_t> r0, r1, r2;
+    residues<P0>(a, na, b, nb, n, r0);
+    residues<P1>(a, na, b, nb, n, r1);
+    residues<P2>(a, na, b, nb, n, r2);
+
+    // Garner: x = v0 + v1 P0 + v2 P0 P1, then shift into (-M/2, M/2]
+    const uint64_t inv01 = powMod(P0, P1 - 2, P1);
+    const uint64_t inv012 = powMod((uint64_t)P0 * P1 % P2, P2 - 2, P2);
+    const unsigned __int128 p01 = (unsigned __int128)P0 * P1;
+    const unsigned __int128 M = p01 * P2;
+    for( size_t i = 0; i < nc; i++ ) {
+        uint64_t v0 = r0[i];
+        uint64_t v1 = (r1[i] + P1 - v0 % P1) % P1 * inv01 % P1;
+        uint64_t x01 = (v0 + v1 * P0) % P2;
+        uint64_t v2 = (r2[i] + P2 - x01) % P2 * inv012 % P2;
+        unsigned __int128 x = v0 + (unsigned __int128)v1 * P0 + v2 * p01;
+        if( x > M / 2 )
+            x -= M;		// wraps: the low 32 bits are still those of x - M
+        out[i] = (int)(uint32_t)x;
+    }
+}
+
+void PolyMultiply(const int *a, unsigned na, const int *b, unsigned nb, int *c) {
+    if( na == 0 || nb == 0 )
+        return;
+    if( min(na, nb) >= NTTThreshold && na + nb - 1 <= maxTransform ) {
+        multiplyNTT(a, na, b, nb, c);
+        return;
+    }
+    multiplyChunked(reinterpret_cast<const uint32_t *>(a), na, reinterpret_cast<const uint32_t *>(b), nb,
+                    reinterpret_cast<uint32_t *>(c));
+}
+
+void PolyMultiply(const float *a, unsigned na, const float *b, unsigned nb, float *c) {
+    if( na == 0 || nb == 0 )
+        return;
+    vector<double> da(a, a + na), db(b, b + nb), dc(na + nb - 1);
+    multiplyChunked(&da[0], na, &db[0], nb, &dc[0]);
+    for( size_t i = 0; i < dc.size(); i++ )
+        c[i] = (float)dc[i];
+}
+
+// evaluation. coefficient i has degree n - 1 - i. float polynomials are
+// evaluated by Horner's rule, one rounding per step, so a point gets the
+// same answer from the scalar and the vector kernels. int arithmetic wraps
+// exactly, so the int path is free to regroup terms (Estrin's scheme)
+
+// Horner's rule in float; the coefficients are whatever type C is
+template<class C> static inline float hornerFloat(const C *c, unsigned n, float x) {
+    float sum = 0;
+    for( unsigned i = 0; i < n; i++ )
+        sum = sum * x + (float)c[i];
+    return sum;
+}
+
+// Horner's rule in wrapping unsigned arithmetic
+static inline uint32_t hornerInt(const uint32_t *c, unsigned n, uint32_t x) {
+    uint32_t sum = 0;
+    for( unsigned i = 0; i < n; i++ )
+        sum = sum * x + c[i];
+    return sum;
+}
+
+int PolyEvaluate(const int *c, unsigned n, int x) {
+    const uint32_t *u = reinterpret_cast<const uint32_t *>(c);
+    uint32_t ux = (uint32_t)x;
+    if( n < 16 )
+        return (int)hornerInt(u, n, ux);
+
+    // four interleaved Horner chains in x^4, one per degree mod 4, so the
+    // multiplies do not wait on each other. the top block is padded with
+    // leading zeros
+    uint32_t x2 = ux * ux, x4 = x2 * x2;
+    uint32_t acc[4] = { 0, 0, 0, 0 };
+    unsigned lead = (4 - n % 4) % 4;
+    unsigned i = 0;
+    for( unsigned k = lead; k < 4; k++ )
+        acc[k] = u[i++];
+    for( ; i < n; i += 4 ) {
+        acc[0] = acc[0] * x4 + u[i];
+        acc[1] = acc[1] * x4 + u[i+1];
+        acc[2] = acc[2] * x4 + u[i+2];
+        acc[3] = acc[3] * x4 + u[i+3];
+    }
+    return (int)((acc[0] * ux + acc[1]) * x2 + acc[2] * ux + acc[3]);
+}
+
+float PolyEvaluate(const float *c, unsigned n, float x) {
+    return hornerFloat(c, n, x);
+}
+
+float PolyEvaluate(const int *c, unsigned n, float x) {
+    return hornerFloat(c, n, x);
+}
+
+// many points at once. each kernel does some multiple of its vector width
+// and returns how many points it did; the rest go through the scalar loop
+
+static unsigned evalFloatScalar(const float *, unsigned, const float *, float *, unsigned) {
+    return 0;
+}
+
+static unsigned evalIntScalar(const int *, unsigned, const int *, int *, unsigned) {
+    return 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+__attribute__((target("sse4.1")))
+static unsigned evalFloatSSE(const float *c, unsigned n, const float *x, float *out, unsigned m) {
+    unsigned j = 0;
+    for( ; j + 4 <= m; j += 4 ) {
+        __m128 px = _mm_loadu_ps(x + j);
+        __m128 sum = _mm_setzero_ps();
+        for( unsigned i = 0; i < n; i++ )
+            sum = _mm_add_ps(_mm_mul_ps(sum, px), _mm_set1_ps(c[i]));
+        _mm_storeu_ps(out + j, sum);
+    }
+    return j;
+}
+
+__attribute__((target("sse4.1")))
+static unsigned evalIntSSE(const int *c, unsigned n, const int *x, int *out, unsigned m) {
+    unsigned j = 0;
+    for( ; j + 4 <= m; j += 4 ) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(x + j));
+        __m128i sum = _mm_setzero_si128();
+        for( unsigned i = 0; i < n; i++ )
+            sum = _mm_add_epi32(_mm_mullo_epi32(sum, px), _mm_set1_epi32(c[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j), sum);
+    }
+    return j;
+}
+
+// two vectors per pass keep two independent multiply chains in flight
+__attribute__((target("avx2")))
+static unsigned evalFloatAVX2(const float *c, unsigned n, const float *x, float *out, unsigned m) {
+    unsigned j = 0;
+    for( ; j + 16 <= m; j += 16 ) {
+        __m256 px0 = _mm256_loadu_ps(x + j);
+        __m256 px1 = _mm256_loadu_ps(x + j + 8);
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        for( unsigned i = 0; i < n; i++ ) {
+            __m256 ci = _mm256_set1_ps(c[i]);
+            s0 = _mm256_add_ps(_mm256_mul_ps(s0, px0), ci);
+            s1 = _mm256_add_ps(_mm256_mul_ps(s1, px1), ci);
+        }
+        _mm256_storeu_ps(out + j, s0);
+        _mm256_storeu_ps(out + j + 8, s1);
+    }
+    for( ; j + 8 <= m; j += 8 ) {
+        __m256 px = _mm256_loadu_ps(x + j);
+        __m256 sum = _mm256_setzero_ps();
+        for( unsigned i = 0; i < n; i++ )
+            sum = _mm256_add_ps(_mm256_mul_ps(sum, px), _mm256_set1_ps(c[i]));
+        _mm256_storeu_ps(out + j, sum);
+    }
+    return j;
+}
+
+__attribute__((target("avx2")))
+static unsigned evalIntAVX2(const int *c, unsigned n, const int *x, int *out, unsigned m) {
+    unsigned j = 0;
+    for( ; j + 16 <= m; j += 16 ) {
+        __m256i px0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + j));
+        __m256i px1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + j + 8));
+        __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+        for( unsigned i = 0; i < n; i++ ) {
+            __m256i ci = _mm256_set1_epi32(c[i]);
+            s0 = _mm256_add_epi32(_mm256_mullo_epi32(s0, px0), ci);
+            s1 = _mm256_add_epi32(_mm256_mullo_epi32(s1, px1), ci);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j), s0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j + 8), s1);
+    }
+    for( ; j + 8 <= m; j += 8 ) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + j));
+        __m256i sum = _mm256_setzero_si256();
+        for( unsigned i = 0; i < n; i++ )
+            sum = _mm256_add_epi32(_mm256_mullo_epi32(sum, px), _mm256_set1_epi32(c[i]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j), sum);
+    }
+    return j;
+}
+#endif
+
+// the widest kernels this processor runs, picked on first use. setting
+// P3_SIMD to scalar, sse or avx2 caps the choice
+struct EvalKernels {
+    const char	*name;
+    unsigned	(*floats)(const float *, unsigned, const float *, float *, unsigned);
+    unsigned	(*ints)(const int *, unsigned, const int *, int *, unsigned);
+};
+
+static EvalKernels pickKernels() {
+    EvalKernels k = { "scalar", evalFloatScalar, evalIntScalar };
+#if defined(__x86_64__) || defined(__i386__)
+    const char *cap = getenv("P3_SIMD");
+    string limit = cap ? cap : "avx2";
+    if( limit == "scalar" )
+        return k;
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("sse4.1") ) {
+        EvalKernels sse = { "sse", evalFloatSSE, evalIntSSE };
+        k = sse;
+    }
+    if( limit == "avx2" && __builtin_cpu_supports("avx2") ) {
+        EvalKernels avx = { "avx2", evalFloatAVX2, evalIntAVX2 };
+        k = avx;
+    }
+#endif
+    return k;
+}
+
+static const EvalKernels& kernels() {
+    static const EvalKernels k = pickKernels();
+    return k;
+}
+
+const char *PolyEvaluateKernel() {
+    return kernels().name;
+}
+
+void PolyEvaluate(const float *c, unsigned n, const float *x, float *out, unsigned m) {
+    for( unsigned j = kernels().floats(c, n, x, out, m); j < m; j++ )
+        out[j] = hornerFloat(c, n, x[j]);
+}
+
+void PolyEvaluate(const int *c, unsigned n, const int *x, int *out, unsigned m) {
+    const uint32_t *u = reinterpret_cast<const uint32_t *>(c);
+    for( unsigned j = kernels().ints(c, n, x, out, m); j < m; j++ )
+        out[j] = (int)hornerInt(u, n, (uint32_t)x[j]);
+}
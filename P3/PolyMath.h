@@ -0,0 +1,55 @@
+/*
+ * PolyMath.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef POLYMATH_H_
+#define POLYMATH_H_
+
+#include <cstdint>
+
+// kernels over flat coefficient arrays. coefficients are stored highest
+// degree first, but a product is the same convolution either way round
+
+// c = a * b; c has room for na + nb - 1 coefficients. integer products wrap
+// exactly as int arithmetic does, whichever algorithm is used. a product
+// whose shorter operand has fewer than 32 coefficients is done term by
+// term, and an integer one whose shorter operand has 4096 or more goes
+// through number theoretic transforms
+extern void PolyMultiply(const int *a, unsigned na, const int *b, unsigned nb, int *c);
+extern void PolyMultiply(const float *a, unsigned na, const float *b, unsigned nb, float *c);
+
+// the value of c at x. int polynomials at int points are exact (wrapping
+// as int does); anything involving a float is done in float
+extern int PolyEvaluate(const int *c, unsigned n, int x);
+extern float PolyEvaluate(const float *c, unsigned n, float x);
+extern float PolyEvaluate(const int *c, unsigned n, float x);
+
+// PolyEvaluate for n of at most 8, the way the kernels above compute it
+// step for step, for the short polynomials a Value holds inline, with none
+// of their setup. the int one is Horner's rule in wrapping unsigned
+// arithmetic
+inline int PolyEvaluateSmall(const int *c, unsigned n, int x) {
+    const uint32_t *u = reinterpret_cast<const uint32_t *>(c);
+    uint32_t ux = (uint32_t)x, sum = 0;
+    for( unsigned k = 0; k < n; k++ )
+        sum = sum * ux + u[k];
+    return (int)sum;
+}
+template<class C> inline float PolyEvaluateSmall(const C *c, unsigned n, float x) {
+    float sum = 0;
+    for( unsigned k = 0; k < n; k++ )
+        sum = sum * x + (float)c[k];
+    return sum;
+}
+
+// out[j] = c evaluated at x[j] for j < m, with the widest SIMD kernel the
+// processor supports. each point gets exactly the single point answer
+extern void PolyEvaluate(const int *c, unsigned n, const int *x, int *out, unsigned m);
+extern void PolyEvaluate(const float *c, unsigned n, const float *x, float *out, unsigned m);
+
+// the name of the kernel PolyEvaluate uses for many points: avx2, sse or scalar
+extern const char *PolyEvaluateKernel();
+
+#endif /* POLYMATH_H_ */
@@ -0,0 +1,368 @@
+/*
+ * SourceBuffer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SourceBuffer.h"
+#include "Output.h"
+#include "ParseNode.h"
+
+using namespace std;
+
+SourceBuffer::SourceBuffer(istream& in, size_t blockSize) : in(&in), fd(-1), ownsFd(false), mapped(0), mappedSize(0),
+    released(0), limit(0), blockSize(blockSize), bytesRead(0), tied(0), pos(0), end(0) {}
+
+SourceBuffer::SourceBuffer(int fd, size_t blockSize) : in(0), fd(fd), ownsFd(false), mapped(0), mappedSize(0),
+    released(0), limit(0), blockSize(blockSize), bytesRead(0), tied(0), pos(0), end(0) {}
+
+SourceBuffer::SourceBuffer() : in(0), fd(-1), ownsFd(false), mapped(0), mappedSize(0), released(0), limit(0),
+    blockSize(1 << 20), bytesRead(0), tied(0), pos(0), end(0) {}
+
+SourceBuffer::~SourceBuffer() {
+    if( mapped )
+        munmap(mapped, mappedSize);
+    if( ownsFd )
+        close(fd);
+    for( size_t i = 0; i < blocks.size(); i++ )
+        delete[] blocks[i];
+}
+
+bool SourceBuffer::Open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if( fd < 0 )
+        return false;
+
+    struct stat st;
+    if( fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ) {
+        // not something we can map (a pipe, say): read it in blocks instead
+        in = 0;
+        this->fd = fd;
+        ownsFd = true;
+        return true;
+    }
+
+    in = 0;
+    pos = end = 0;
+    if( st.st_size > 0 ) {
+        void *p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if( p == MAP_FAILED ) {
+            close(fd);
+            return false;
+        }
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        mapped = static_cast<char *>(p);
+        mappedSize = st.st_size;
+        released = mapped;
+        pos = mapped;
+        end = mapped + mappedSize;
+        bytesRead = mappedSize;
+    }
+    close(fd);
+    return true;
+}
+
+// up to n bytes from the stream or descriptor; 0 at end of input
+size_t SourceBuffer::read(char *to, size_t n) {
+    if( tied )
+        tied->Flush();
+    if( in ) {
+        if( !*in )
+            return 0;
+        in->read(to, n);
+        return in->gcount();
+    }
+    while( true ) {
+        ssize_t got = ::read(fd, to, n);
+        if( got >= 0 )
+            return got;
+        if( errno != EINTR )
+            return 0;
+    }
+}
+
+bool SourceBuffer::Fill(const char *&mark) {
+    if( in == 0 && fd < 0 )
+        return false;
+
+    // room left in the last block: read straight in after what is there
+    if( !blocks.empty() && end < limit ) {
+        size_t got = read(const_cast<char *>(end), limit - end);
+        if( got == 0 )
+            return false;
+        bytesRead += got;
+        pos = end;
+        end += got;
+        return true;
+    }
+
+    size_t keep = end - mark;
+    size_t size = keep * 2 > blockSize ? keep * 2 : blockSize;
+    char *block = new char[size];
+    memcpy(block, mark, keep);
+    size_t got = read(block + keep, size - keep);
+    if( got == 0 ) {
+        delete[] block;
+        return false;
+    }
+    blocks.push_back(block);
+    limit = block + size;
+    bytesRead += got;
+
+    mark = block;
+    pos = block + keep;
+    end = pos + got;
+    return true;
+}
+
+void SourceBuffer::Release() {
+    // every block but the one being read from is behind pos
+    if( blocks.size() > 1 ) {
+        for( size_t i = 0; i + 1 < blocks.size(); i++ )
+            delete[] blocks[i];
+        blocks.erase(blocks.begin(), blocks.end() - 1);
+    }
+
+    // let the kernel drop mapped pages we are done with, a few MB at a time
+    const size_t chunk = 4 << 20;
+    if( mapped && pos - released >= (ptrdiff_t)chunk ) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t upto = (pos - mapped) / page * page;
+        madvise(const_cast<char *>(released), mapped + upto - released, MADV_DONTNEED);
+        released = mapped + upto;
+    }
+}
+
+// character classes for the scanner. the table is filled from the same
+// <cctype> calls the istream lexer makes, so both lexers classify every byte
+// the same way; it just saves a call per byte
+enum { SPACE = 1, ALPHA = 2, DIGIT = 4, ALNUM = ALPHA|DIGIT };
+
+static unsigned char charClass[256];
+
+static bool initCharClass() {
+    for( int i = 0; i < 256; i++ ) {
+        char ch = (char)i;
+        charClass[i] = (isspace(ch) ? SPACE : 0) | (isalpha(ch) ? ALPHA : 0) | (isdigit(ch) ? DIGIT : 0);
+    }
+    return true;
+}
+static bool charClassReady = initCharClass();
+
+static inline bool is(char ch, int cls) { return (charClass[(unsigned char)ch] & cls) != 0; }
+
+// true if text holds exactly the keyword word
+static inline bool isWord(const char *text, unsigned len, const char *word) {
+    return len == strlen(word) && memcmp(text, word, len) == 0;
+}
+
+// the same state machine as getToken(istream&), run over the raw bytes of the
+// buffer. a lexeme is normally the run of bytes [lex, lex + len); only when
+// a newline interrupts a lexeme (the old lexer carries it on into the next
+// one) is it gathered into a string instead
+Token *getToken(Interpreter& interp, SourceBuffer& src) {
+    enum State { START, INID, INSTRING, INICONST, INFCONST, INCOMMENT};
+
+    State lexstate = START;
+    const char *p = src.pos;
+    const char *lex = p;
+    unsigned len = 0;
+    string spill;
+    bool spilled = false;
+    bool atEnd = false;
+    bool bad = false;
+
+// make sure p is not at the end of the buffer, if there is more input
+#define REFILL() \
+    do { \
+        if( p == src.end ) { \
+            const char *mark = len && !spilled ? lex : p; \
+            if( src.Fill(mark) ) { \
+                if( len && !spilled ) lex = mark; \
+                p = src.pos; \
+            } \
+        } \
+    } while( 0 )
+
+// add the byte just read to the lexeme
+#define APPEND(c) \
+    do { \
+        if( spilled ) spill += (c); \
+        else if( len == 0 ) { lex = p - 1; len = 1; } \
+        else if( lex + len == p - 1 ) len++; \
+        else { spill.assign(lex, len); spill += (c); spilled = true; } \
+    } while( 0 )
+
+    while(true){
+        REFILL();
+        if( p == src.end ) {
+            atEnd = true;
+            break;
+        }
+        char ch = *p++;
+
+        if( ch == '\n' ) {
+            interp.currentLine++;
+            lexstate = START;
+            continue;
+        }
+
+        if(is(ch, SPACE) && (lexstate == START)) continue;
+        switch( lexstate ) {
+            case START:
+                if( is(ch, ALPHA) ) {
+                    lexstate = INID;
+                    APPEND(ch);
+                    continue;
+                } else if( is(ch, DIGIT) ) {
+                    lexstate = INICONST;
+                    APPEND(ch);
+                    continue;
+                } else if( ch == '#' ) {
+                    lexstate = INCOMMENT;
+                    continue;
+                } else if( ch == '"' ) {
+                    lexstate = INSTRING;
+                    continue;
+                } else if( ch == '-' ) {
+                    // maybe minus? maybe leading sign on a number?
+                    REFILL();
+                    if( p != src.end && is(*p, DIGIT) ) {
+                        lexstate = INICONST;
+                        continue;
+                    }
+                }
+
+                src.pos = p;
+                switch( ch ) {
+                    case ';': return interp.NewToken(SC, ";", 1);
+                    case '+': return interp.NewToken(PLUS, "+", 1);
+                    case '-': return interp.NewToken(MINUS, "-", 1);
+                    case '*': return interp.NewToken(STAR, "*", 1);
+                    case '[': return interp.NewToken(LSQ, "[", 1);
+                    case ']': return interp.NewToken(RSQ, "]", 1);
+                    case '(': return interp.NewToken(LPAREN, "(", 1);
+                    case ')': return interp.NewToken(RPAREN, ")", 1);
+                    case '{': return interp.NewToken(LBR, "{", 1);
+                    case '}': return interp.NewToken(RBR, "}", 1);
+                    case ',': return interp.NewToken(COMMA, ",", 1);
+                }
+                interp.ParseError("Error parsing lexeme " + (spilled ? spill : string(lex, len)));
+                bad = true;
+                break;
+
+            case INID:
+                if( is(ch, ALNUM) ) {
+                    APPEND(ch);
+                    while( p != src.end && is(*p, ALNUM) && !spilled ) {
+                        ++p;
+                        ++len;
+                    }
+                    continue;
+                }
+                --p;
+                break;
+
+            case INSTRING:
+                if( ch == '"' )
+                    break;
+                APPEND(ch);
+                while( p != src.end && *p != '"' && *p != '\n' && !spilled ) {
+                    ++p;
+                    ++len;
+                }
+                continue;
+
+            case INICONST:
+                if( is(ch, DIGIT) ) {
+                    APPEND(ch);
+                    while( p != src.end && is(*p, DIGIT) && !spilled ) {
+                        ++p;
+                        ++len;
+                    }
+                    continue;
+                } else if( ch == '.' ) {
+                    APPEND(ch);
+                    REFILL();
+                    if( p != src.end && is(*p, DIGIT) ) {
+                        lexstate = INFCONST;
+                        continue;
+                    }
+                    interp.ParseError("Invalid float.");
+                    bad = true;
+                    break;
+                }
+                --p;
+                break;
+
+            case INFCONST:
+                if( is(ch, DIGIT) ) {
+                    APPEND(ch);
+                    while( p != src.end && is(*p, DIGIT) && !spilled ) {
+                        ++p;
+                        ++len;
+                    }
+                    continue;
+                }
+                --p;
+                break;
+
+            case INCOMMENT:
+                // nothing to do until the newline
+                {
+                    const char *nl = static_cast<const char *>(memchr(p, '\n', src.end - p));
+                    p = nl ? nl : src.end;
+                }
+                continue;
+        }
+        break;
+    }
+#undef APPEND
+#undef REFILL
+
+    src.pos = p;
+
+    // a lexeme gathered into a string is copied into the arena
+    const char *text = lex;
+    if( spilled ) {
+        char *copy = static_cast<char *>(interp.arena.Allocate(spill.size(), 1));
+        memcpy(copy, spill.data(), spill.size());
+        text = copy;
+        len = (unsigned)spill.size();
+    }
+
+    // handle getting DONE or ERR when not in start state
+    if( atEnd ) {
+        if( lexstate == START || lexstate == INSTRING || lexstate == INCOMMENT )
+            return interp.NewToken(DONE, "Done", 4);
+        return interp.NewToken(ERR, text, len);
+    }
+    if( bad )
+        return interp.NewToken(ERR, text, len);
+
+    switch( lexstate ) {
+        case INID:
+            if( isWord(text, len, "set") )
+                return interp.NewToken(SET, text, len);
+            else if( isWord(text, len, "print") )
+                return interp.NewToken(PRINT, text, len);
+            return interp.NewToken(ID, text, len);
+        case INSTRING:
+            return interp.NewToken(STRING, text, len);
+        case INICONST:
+            return interp.NewToken(ICONST, text, len);
+        case INFCONST:
+            return interp.NewToken(FCONST, text, len);
+        default:
+            return interp.NewToken(ERR, text, len);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * SourceBuffer.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SOURCEBUFFER_H_
+#define SOURCEBUFFER_H_
+
+#include <istream>
+#include <vector>
+#include <cstddef>
+
+class Output;
+
+// the raw bytes of a program for the buffered lexer. a file is memory mapped
+// whole; a stream (stdin, a pipe) is read in large blocks. the lexer scans
+// [pos, end) directly and tokens point into it, so every block stays alive
+// until Release() says no token needs it any more
+class SourceBuffer {
+    std::istream		*in;
+    int					fd;
+    bool				ownsFd;
+    char				*mapped;
+    size_t				mappedSize;
+    const char			*released;	// mapped bytes before this were dropped
+    std::vector<char *>	blocks;
+    char				*limit;		// the end of the storage of the last block
+    size_t				blockSize;
+    size_t				bytesRead;
+    Output				*tied;
+
+    SourceBuffer(const SourceBuffer&);
+    SourceBuffer& operator=(const SourceBuffer&);
+
+    size_t read(char *to, size_t n);
+
+public:
+    const char	*pos;
+    const char	*end;
+
+    explicit SourceBuffer(std::istream& in, size_t blockSize = 1 << 20);
+    // read from a file descriptor, taking whatever each read returns, so a
+    // pipe is lexed as soon as its data arrives
+    explicit SourceBuffer(int fd, size_t blockSize = 1 << 20);
+    SourceBuffer();
+    ~SourceBuffer();
+
+    // map the named file; false if it cannot be opened
+    bool Open(const char *path);
+
+    // flush out before blocking on a read, the way istream::tie does
+    void Tie(Output *out) { tied = out; }
+
+    // called when pos reaches end. makes more input available, keeping the
+    // bytes from mark onward contiguous in front of it; mark is updated to
+    // where those bytes now live. false at end of input
+    bool Fill(const char *&mark);
+
+    // give back the input before pos. only safe when no token still points
+    // into it
+    void Release();
+
+    size_t BytesRead() const { return bytesRead; }
+};
+
+#endif /* SOURCEBUFFER_H_ */
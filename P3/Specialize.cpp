@@ -0,0 +1,128 @@
+/*
+ * Specialize.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <string>
+
+#include "ParseNode.h"
+
+using namespace std;
+
+// a value of type t, to try an operator on
+static Value sample(StaticType t) {
+    switch( t.t ) {
+        case INTEGERVAL:
+            return Value(1);
+        case FLOATVAL:
+            return Value(1.0f);
+        case STRINGVAL:
+            return Value(string("s"));
+        case POLYVAL:
+        case LISTVAL: {
+            Value v = t.t == POLYVAL ? Value::Poly(1, t.isFloat) : Value::List(1, t.isFloat);
+            if( t.isFloat )
+                v.PolyFloats()[0] = 1;
+            else
+                v.PolyInts()[0] = 1;
+            return v;
+        }
+        default:
+            return Value();
+    }
+}
+
+// the type of a op b for operands of types a and b, or unknown if that is an
+// error. whether an operator works, and what it gives, depends only on the
+// types of its operands, so trying it on any values of those types tells;
+// that keeps this in step with Value's operators without repeating them.
+// every pair is tried once, up front, rather than for every node
+class ArithmeticTypes {
+    static const int Kinds = 2 * UNKNOWNVAL;	// each known type, int or float
+    StaticType	results[3][Kinds][Kinds];
+
+    static int kind(StaticType t) { return 2 * t.t + t.isFloat; }
+    static StaticType ofKind(int k) { return StaticType((Type)(k / 2), k % 2 != 0); }
+
+public:
+    ArithmeticTypes() {
+        Value (Value::*ops[3])(const Value&) const = { &Value::operator+, &Value::operator-, &Value::operator* };
+        for( int op = 0; op < 3; op++ )
+            for( int a = 0; a < Kinds; a++ )
+                for( int b = 0; b < Kinds; b++ )
+                    results[op][a][b] = StaticType::Of((sample(ofKind(a)).*ops[op])(sample(ofKind(b))));
+    }
+    // op is 0, 1 or 2 for +, - and *
+    StaticType Of(int op, StaticType a, StaticType b) const {
+        if( !a.Known() || !b.Known() )
+            return StaticType();
+        return results[op][kind(a)][kind(b)];
+    }
+};
+
+static StaticType arithmeticType(int op, StaticType a, StaticType b) {
+    static const ArithmeticTypes types;
+    return types.Of(op, a, b);
+}
+
+// the variant of G for operands of types a and b, or node if there is none
+template<class G, class Op>
+static ParseNode *specializeArithmetic(Interpreter& interp, G *node, StaticType a, StaticType b) {
+    ParseNode *l = node->leftNode();
+    ParseNode *r = node->rightNode();
+    if( a.t == INTEGERVAL && b.t == INTEGERVAL )
+        return interp.New< Typed<G, Scalars<Op,int,int> > >(l, r);
+    if( a.t == INTEGERVAL && b.t == FLOATVAL )
+        return interp.New< Typed<G, Scalars<Op,int,float> > >(l, r);
+    if( a.t == FLOATVAL && b.t == INTEGERVAL )
+        return interp.New< Typed<G, Scalars<Op,float,int> > >(l, r);
+    if( a.t == FLOATVAL && b.t == FLOATVAL )
+        return interp.New< Typed<G, Scalars<Op,float,float> > >(l, r);
+    if( a.t == POLYVAL && b.t == POLYVAL && !a.isFloat && !b.isFloat )
+        return interp.New< Typed<G, IntPolys<Op> > >(l, r);
+    return node;
+}
+
+ParseNode *PlusOp::SpecializeOp(Interpreter& interp, StaticType a, StaticType b, StaticType& type) {
+    type = arithmeticType(0, a, b);
+    return specializeArithmetic<PlusOp, Add>(interp, this, a, b);
+}
+
+ParseNode *MinusOp::SpecializeOp(Interpreter& interp, StaticType a, StaticType b, StaticType& type) {
+    type = arithmeticType(1, a, b);
+    return specializeArithmetic<MinusOp, Subtract>(interp, this, a, b);
+}
+
+ParseNode *TimesOp::SpecializeOp(Interpreter& interp, StaticType a, StaticType b, StaticType& type) {
+    type = arithmeticType(2, a, b);
+    return specializeArithmetic<TimesOp, Multiply>(interp, this, a, b);
+}
+
+ParseNode *EvaluateAt::Specialize(Interpreter& interp, StaticType& type) {
+    StaticType p, x;
+    if( leftNode() ) setLeft(leftNode()->Specialize(interp, p));
+    if( rightNode() ) setRight(rightNode()->Specialize(interp, x));
+    type = StaticType();
+    if( p.t != POLYVAL )
+        return this;
+    if( x.t == LISTVAL ) {
+        type = StaticType(LISTVAL, p.isFloat || x.isFloat);
+        return this;
+    }
+    if( x.t != INTEGERVAL && x.t != FLOATVAL )
+        return this;
+
+    type = StaticType(!p.isFloat && x.t == INTEGERVAL ? INTEGERVAL : FLOATVAL);
+    ParseNode *l = leftNode();
+    ParseNode *r = rightNode();
+    if( p.isFloat )
+        return x.t == FLOATVAL ? (ParseNode *)interp.New< TypedEvaluateAt<float,float> >(l, r)
+            : interp.New< TypedEvaluateAt<float,int> >(l, r);
+    return x.t == FLOATVAL ? (ParseNode *)interp.New< TypedEvaluateAt<int,float> >(l, r)
+        : interp.New< TypedEvaluateAt<int,int> >(l, r);
+}
+
+ParseNode *SpecializeTypes(Interpreter& interp, ParseNode *program) {
+    StaticType type;
+    return program->Specialize(interp, type);
+}
@@ -0,0 +1,72 @@
+/*
+ * Stats.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "Stats.h"
+
+using namespace std;
+
+static const char *tokenNames[ERR + 1] = {
+    "ID", "ICONST", "FCONST", "STRING", "PRINT", "SET", "PLUS", "MINUS", "STAR", "COMMA",
+    "LBR", "RBR", "LSQ", "RSQ", "LPAREN", "RPAREN", "SC", "NEWLINE", "DONE", "ERR",
+};
+
+static bool bySelfTime(const pair<string,NodeStats>& a, const pair<string,NodeStats>& b) {
+    return a.second.self > b.second.self;
+}
+
+void EvalStats::Report(ostream& out, int symbols) const {
+    vector< pair<string,NodeStats> > sorted(rows.begin(), rows.end());
+    sort(sorted.begin(), sorted.end(), bySelfTime);
+
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out << fixed << setprecision(3);
+
+    if( !sorted.empty() ) {
+        out << left << setw(16) << "node" << right << setw(12) << "calls" << setw(12) << "total ms"
+            << setw(12) << "self ms" << setw(12) << "allocs" << setw(12) << "coeffs" << "\n";
+        for( size_t k = 0; k < sorted.size(); k++ ) {
+            const NodeStats& r = sorted[k].second;
+            out << left << setw(16) << sorted[k].first << right << setw(12) << r.calls
+                << setw(12) << r.total * 1000 << setw(12) << r.self * 1000
+                << setw(12) << r.allocs << setw(12) << r.coefficients << "\n";
+        }
+    }
+
+    unsigned long all = 0;
+    out << "tokens:";
+    for( int k = 0; k <= ERR; k++ ) {
+        if( tokens[k] == 0 )
+            continue;
+        out << " " << tokenNames[k] << " " << tokens[k];
+        all += tokens[k];
+    }
+    out << " (" << all << " in all)\n";
+    out << "symbols: " << symbols << endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void EvalStats::WriteStacks(ostream& out, bool bytes) const {
+    vector<string> stack;
+    for( size_t k = 0; k < paths.size(); k++ ) {
+        const Path& p = paths[k];
+        unsigned long weight = bytes ? p.bytes : (unsigned long)(p.self * 1e9);
+        if( weight == 0 )
+            continue;
+        stack.clear();
+        for( int q = (int)k; q >= 0; q = paths[q].parent )
+            stack.push_back(paths[q].label);
+        for( size_t d = stack.size(); d-- > 0; )
+            out << stack[d] << (d ? ";" : " ");
+        out << weight << "\n";
+    }
+    out.flush();
+}
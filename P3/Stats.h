@@ -0,0 +1,167 @@
+/*
+ * Stats.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+#include "polylex.h"
+#include "Value.h"
+
+// what --stats gathers for one kind of node. total time counts only the
+// outermost of nested calls, so a PlusOp inside a PlusOp is not counted
+// twice; self time and allocations leave out the nodes below
+struct NodeStats {
+    std::string		kind;
+    unsigned long	calls;
+    double			total;
+    double			self;
+    unsigned long	allocs;
+    unsigned long	coefficients;
+    int				active;
+    NodeStats() : calls(0), total(0), self(0), allocs(0), coefficients(0), active(0) {}
+};
+
+// counts for --stats and --profile. tokens are counted always, being one add
+// each; the nodes are only timed once Profile has wrapped them, so a run
+// without either flag does none of the work below
+class EvalStats {
+    typedef std::chrono::steady_clock clock;
+
+    // one distinct stack of frames, from a statement's line down, for
+    // --profile. children are found by the row (or line) they are for
+    struct Path {
+        int								parent;
+        std::string						label;
+        std::map<std::pair<const NodeStats *,int>,int>	children;
+        double							self;
+        unsigned long					bytes;
+        Path(int parent, const std::string& label) : parent(parent), label(label), self(0), bytes(0) {}
+    };
+
+    struct Frame {
+        NodeStats			*row;		// 0 for a statement's line
+        int					path;
+        clock::time_point	start;
+        unsigned long		allocs;
+        unsigned long		coefficients;
+        unsigned long		bytes;
+        double				childTime;
+        unsigned long		childAllocs;
+        unsigned long		childCoefficients;
+        unsigned long		childBytes;
+    };
+
+    typedef std::map<std::pair<const NodeStats *,int>,int> PathMap;
+
+    std::map<std::string,NodeStats>	rows;
+    std::vector<Frame>				frames;
+    std::vector<Path>				paths;
+    PathMap							roots;
+    bool							tracePaths;
+
+    // the path one frame below the current one
+    int pathTo(const NodeStats *row, int line) {
+        int parent = frames.empty() ? -1 : frames.back().path;
+        PathMap& children = parent < 0 ? roots : paths[parent].children;
+        std::pair<const NodeStats *,int> key(row, line);
+        PathMap::iterator it = children.find(key);
+        if( it != children.end() )
+            return it->second;
+        int k = (int)paths.size();
+        children[key] = k;
+        paths.push_back(Path(parent, row ? row->kind : "line " + std::to_string(line)));
+        return k;
+    }
+
+    void enter(NodeStats *row, int line) {
+        Frame f;
+        f.row = row;
+        f.path = tracePaths ? pathTo(row, line) : -1;
+        f.allocs = valueAllocs.blocks;
+        f.coefficients = valueAllocs.coefficients;
+        f.bytes = valueAllocs.bytes;
+        f.childTime = 0;
+        f.childAllocs = 0;
+        f.childCoefficients = 0;
+        f.childBytes = 0;
+        frames.push_back(f);
+        frames.back().start = clock::now();
+    }
+
+public:
+    unsigned long	tokens[ERR + 1];
+
+    EvalStats() : tracePaths(false) {
+        for( int k = 0; k <= ERR; k++ )
+            tokens[k] = 0;
+    }
+
+    NodeStats *Row(const std::string& kind) {
+        NodeStats *row = &rows[kind];
+        row->kind = kind;
+        return row;
+    }
+
+    // keep the time and bytes of every distinct stack, not just of every
+    // kind of node
+    void TracePaths() { tracePaths = true; }
+
+    void Enter(NodeStats *row) {
+        ++row->active;
+        ++row->calls;
+        enter(row, 0);
+    }
+    // the statement on line; a frame of its own in the stacks, but not a row
+    void EnterLine(int line) {
+        enter(0, line);
+    }
+
+    void Leave() {
+        clock::time_point now = clock::now();
+        Frame& f = frames.back();
+        double t = std::chrono::duration<double>(now - f.start).count();
+        unsigned long allocs = valueAllocs.blocks - f.allocs;
+        unsigned long coefficients = valueAllocs.coefficients - f.coefficients;
+        unsigned long bytes = valueAllocs.bytes - f.bytes;
+
+        if( NodeStats *row = f.row ) {
+            if( --row->active == 0 )
+                row->total += t;
+            row->self += t - f.childTime;
+            row->allocs += allocs - f.childAllocs;
+            row->coefficients += coefficients - f.childCoefficients;
+        }
+        if( f.path >= 0 ) {
+            paths[f.path].self += t - f.childTime;
+            paths[f.path].bytes += bytes - f.childBytes;
+        }
+        frames.pop_back();
+
+        if( !frames.empty() ) {
+            Frame& parent = frames.back();
+            parent.childTime += t;
+            parent.childAllocs += allocs;
+            parent.childCoefficients += coefficients;
+            parent.childBytes += bytes;
+        }
+    }
+
+    // the table printed at exit: nodes by self time, then tokens by kind
+    void Report(std::ostream& out, int symbols) const;
+
+    // every stack as "line 12;SetStatement;PlusOp;Ident", the collapsed
+    // form flamegraph tools read, weighted by self time in nanoseconds or by
+    // bytes allocated. stacks that come to nothing are left out
+    void WriteStacks(std::ostream& out, bool bytes) const;
+};
+
+#endif /* STATS_H_ */
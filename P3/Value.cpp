@@ -0,0 +1,842 @@
+/*
+ * Value.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Value.h"
+#include "Output.h"
+#include "PolyMath.h"
+
+using namespace std;
+
+static_assert(sizeof(int) == sizeof(float), "coefficient storage assumes int and float are the same size");
+
+thread_local AllocCounts valueAllocs;
+thread_local ValueRegion valueRegion;
+
+void *ValueRegion::grow(size_t n) {
+    Chunk *next = current ? current->next : first;
+    if( current )
+        before += top - start(current);
+    if( next == 0 ) {
+        next = static_cast<Chunk *>(malloc(ChunkBytes));
+        if( next == 0 )
+            throw bad_alloc();
+        next->next = 0;
+        if( current ) current->next = next; else first = next;
+        reserved += ChunkBytes;
+    }
+    current = next;
+    top = start(next) + n;
+    end = reinterpret_cast<char *>(next) + ChunkBytes;
+    return start(next);
+}
+
+void ValueRegion::Reset() {
+    if( current ) {
+        size_t used = before + (top - start(current));
+        if( used > peak )
+            peak = used;
+        current = first;
+        top = start(first);
+        end = reinterpret_cast<char *>(first) + ChunkBytes;
+        before = 0;
+    }
+    ++statements;
+}
+
+void ValueRegion::Release() {
+    while( first ) {
+        Chunk *next = first->next;
+        free(first);
+        first = next;
+    }
+    current = 0;
+    top = end = 0;
+    before = 0;
+    reserved = 0;
+}
+
+size_t PolyRep::Bytes(unsigned size, bool mixed) {
+    size_t bytes = offsetof(PolyRep, c) + (size ? size : 1) * sizeof(int);
+    return mixed ? bytes + size * (sizeof(int) + 1) : bytes;
+}
+
+PolyRep *PolyRep::Make(unsigned size, bool isFloat, bool mixed) {
+    size_t bytes = Bytes(size, mixed);
+    PolyRep *p = static_cast<PolyRep *>(valueRegion.Allocate(bytes));
+    bool inRegion = p != 0;
+    if( !inRegion ) {
+        p = static_cast<PolyRep *>(malloc(bytes));
+        if( p == 0 )
+            throw bad_alloc();
+    }
+    p->size = size;
+    p->refs = 1;
+    p->isFloat = isFloat;
+    p->mixed = mixed;
+    p->inRegion = inRegion;
+    ++valueAllocs.blocks;
+    valueAllocs.coefficients += size;
+    valueAllocs.bytes += bytes;
+    return p;
+}
+
+PolyRep *PolyRep::Copy(const PolyRep *p) {
+    PolyRep *n = Make(p->size, p->isFloat, p->mixed);
+    memcpy(n->c.i, p->c.i, Bytes(p->size, p->mixed) - offsetof(PolyRep, c));
+    return n;
+}
+
+// a block taken from the region goes back with the rest of them when its
+// statement is done
+void PolyRep::Free(PolyRep *p) {
+    if( !p->inRegion )
+        free(p);
+}
+
+StringRep *StringRep::Text(const char *s, size_t n) {
+    size_t bytes = offsetof(StringRep, text) + (n ? n : 1);
+    StringRep *r = static_cast<StringRep *>(malloc(bytes));
+    if( r == 0 )
+        throw bad_alloc();
+    r->refs = 1;
+    r->kind = TEXT;
+    r->length = n;
+    r->first = r->second = 0;
+    r->count = 0;
+    memcpy(r->text, s, n);
+    ++valueAllocs.blocks;
+    valueAllocs.bytes += bytes;
+    return r;
+}
+
+// a node over other nodes, which it takes the references to
+static StringRep *makeNode(StringRep::Kind kind, size_t length, StringRep *first, StringRep *second, size_t count) {
+    StringRep *r = static_cast<StringRep *>(malloc(sizeof(StringRep)));
+    if( r == 0 )
+        throw bad_alloc();
+    r->refs = 1;
+    r->kind = kind;
+    r->length = length;
+    r->first = first;
+    r->second = second;
+    r->count = count;
+    ++valueAllocs.blocks;
+    valueAllocs.bytes += sizeof(StringRep);
+    return r;
+}
+
+// strings this short are copied whole rather than joined by a node, which
+// would take as much room as they do
+static const size_t ShortString = 32;
+
+StringRep *StringRep::Concat(StringRep *a, StringRep *b) {
+    if( b->length == 0 ) {
+        Release(b);
+        return a;
+    }
+    if( a->length == 0 ) {
+        Release(a);
+        return b;
+    }
+    if( a->length > ~(size_t)0 - b->length )
+        throw length_error("string too long");
+    if( a->kind == TEXT && b->kind == TEXT && a->length + b->length <= ShortString ) {
+        char both[ShortString];
+        memcpy(both, a->text, a->length);
+        memcpy(both + a->length, b->text, b->length);
+        StringRep *r = Text(both, a->length + b->length);
+        Release(a);
+        Release(b);
+        return r;
+    }
+    return makeNode(CONCAT, a->length + b->length, a, b, 0);
+}
+
+StringRep *StringRep::Repeat(StringRep *a, size_t count) {
+    if( count == 1 )
+        return a;
+    if( count == 0 || a->length == 0 ) {
+        Release(a);
+        return Text("", 0);
+    }
+    if( a->length > ~(size_t)0 / count )
+        throw length_error("string too long");
+    if( a->kind == TEXT && a->length * count <= ShortString ) {
+        char all[ShortString];
+        for( size_t k = 0; k < count; k++ )
+            memcpy(all + k * a->length, a->text, a->length);
+        StringRep *r = Text(all, a->length * count);
+        Release(a);
+        return r;
+    }
+    return makeNode(REPEAT, a->length * count, a, 0, count);
+}
+
+// the nodes only this one held go with it
+void StringRep::free() {
+    vector<StringRep *> dead(1, this);
+    while( !dead.empty() ) {
+        StringRep *r = dead.back();
+        dead.pop_back();
+        if( r->first && --r->first->refs == 0 )
+            dead.push_back(r->first);
+        if( r->second && --r->second->refs == 0 )
+            dead.push_back(r->second);
+        ::free(r);
+    }
+}
+
+// a repetition of a string no longer than this is written from a buffer
+// holding as many copies as fit, so each write is a good size
+static const size_t RepeatBuffer = 4096;
+
+// pass the characters of r in order to sink(const char *, size_t), a piece
+// at a time, keeping the nodes still to visit on an explicit stack, each
+// with the number of times it is still to be written. the walk stops when
+// sink returns false
+template<class Sink>
+static void walk(const StringRep *r, Sink sink) {
+    vector< pair<const StringRep *,size_t> > stack(1, make_pair(r, (size_t)1));
+    string copies;
+    while( !stack.empty() ) {
+        const StringRep *n = stack.back().first;
+        if( --stack.back().second == 0 )
+            stack.pop_back();
+        if( n->kind == StringRep::TEXT ) {
+            if( !sink(n->text, n->length) )
+                return;
+        } else if( n->kind == StringRep::CONCAT ) {
+            stack.push_back(make_pair(n->second, (size_t)1));
+            stack.push_back(make_pair(n->first, (size_t)1));
+        } else if( n->first->length > RepeatBuffer / 2 )
+            stack.push_back(make_pair(n->first, n->count));
+        else {
+            size_t len = n->first->length;
+            copies = n->first->Flatten();
+            size_t fit = RepeatBuffer / len;
+            if( fit > n->count )
+                fit = n->count;
+            copies.reserve(fit * len);
+            for( size_t k = 1; k < fit; k++ )
+                copies.append(copies.data(), len);
+            for( size_t left = n->count; left > 0; left -= fit < left ? fit : left )
+                if( !sink(copies.data(), (fit < left ? fit : left) * len) )
+                    return;
+        }
+    }
+}
+
+void StringRep::Write(Output& out) const {
+    walk(this, [&out](const char *s, size_t n) { out.Write(s, n); return true; });
+}
+
+string StringRep::Flatten() const {
+    string all;
+    all.reserve(length);
+    walk(this, [&all](const char *s, size_t n) { all.append(s, n); return true; });
+    return all;
+}
+
+string StringRep::Prefix(size_t n) const {
+    string part;
+    part.reserve(n < length ? n : length);
+    walk(this, [&part, n](const char *s, size_t k) -> bool {
+        part.append(s, k < n - part.size() ? k : n - part.size());
+        return part.size() < n;
+    });
+    return part;
+}
+
+bool StringRep::AppendShape(string& sig, size_t limit) const {
+    vector<const StringRep *> stack(1, this);
+    for( size_t visited = 0; !stack.empty(); visited++ ) {
+        if( visited == limit )
+            return false;
+        const StringRep *n = stack.back();
+        stack.pop_back();
+        sig += (char)n->kind;
+        if( n->kind == TEXT ) {
+            sig.append((const char *)&n->length, sizeof n->length);
+            sig.append(n->text, n->length);
+        } else if( n->kind == CONCAT ) {
+            stack.push_back(n->second);
+            stack.push_back(n->first);
+        } else {
+            sig.append((const char *)&n->count, sizeof n->count);
+            stack.push_back(n->first);
+        }
+    }
+    return true;
+}
+
+void Value::keep() {
+    bool active = valueRegion.active;
+    valueRegion.active = false;
+    PolyRep *n = PolyRep::Copy(p);
+    valueRegion.active = active;
+    ++valueRegion.kept;
+    valueRegion.keptBytes += PolyRep::Bytes(p->size, p->mixed);
+    if( --p->refs == 0 )
+        PolyRep::Free(p);
+    p = n;
+}
+
+// coefficient k of p as a float, whatever p stores
+static inline float floatAt(const Value& p, unsigned k) {
+    return p.PolyIsFloat() ? p.PolyFloats()[k] : (float)p.PolyInts()[k];
+}
+
+// one coefficient with its own type, for the operations whose result is
+// mixed. ints are added and multiplied as uint32_t, which wraps as int does;
+// an int with a float gives a float, as with scalars
+struct Coefficient {
+    bool	isInt;
+    int		i;
+    float	f;
+
+    static Coefficient Int(int i) { Coefficient c = { true, i, (float)i }; return c; }
+    static Coefficient Float(float f) { Coefficient c = { false, 0, f }; return c; }
+    static Coefficient Of(const Value& x) {
+        return x.GetType() == INTEGERVAL ? Int(x.GetIntValue()) : Float(x.GetFloatValue());
+    }
+    static Coefficient At(const Value& p, unsigned k) {
+        return p.IsIntAt(k) ? Int(p.IntAt(k)) : Float(p.PolyFloats()[k]);
+    }
+
+    Coefficient operator-() const { return isInt ? Int((int)(0u - (uint32_t)i)) : Float(-f); }
+    Coefficient Combine(Coefficient b, bool subtract) const {
+        if( isInt && b.isInt )
+            return Int((int)(subtract ? (uint32_t)i - (uint32_t)b.i : (uint32_t)i + (uint32_t)b.i));
+        return Float(subtract ? f - b.f : f + b.f);
+    }
+    Coefficient operator*(Coefficient b) const {
+        return isInt && b.isInt ? Int((int)((uint32_t)i * (uint32_t)b.i)) : Float(f * b.f);
+    }
+};
+
+// a polynomial of the coefficients in c: int or float if they all are, mixed
+// if not
+static Value fromCoefficients(const vector<Coefficient>& c) {
+    unsigned n = (unsigned)c.size(), ints = 0;
+    for( unsigned k = 0; k < n; k++ )
+        ints += c[k].isInt;
+    if( ints == n ) {
+        Value r = Value::Poly(n, false);
+        for( unsigned k = 0; k < n; k++ )
+            r.PolyInts()[k] = c[k].i;
+        return r;
+    }
+    Value r = ints ? Value::MixedPoly(n) : Value::Poly(n, true);
+    float *out = r.PolyFloats();
+    for( unsigned k = 0; k < n; k++ ) {
+        if( c[k].isInt )
+            r.SetInt(k, c[k].i);
+        else
+            out[k] = c[k].f;
+    }
+    return r;
+}
+
+// fast paths for two polynomials held inline, straight into the result's
+// own inline coefficients. every loop is bounded by InlineTerms, and each
+// coefficient is worked out whole before it is stored. ints are added and
+// multiplied as uint32_t, which wraps as int does
+static const unsigned Small = Value::InlineTerms;
+
+// both held inline and neither empty
+static inline bool bothSmall(const Value& a, const Value& b) {
+    return a.PolyInline() && b.PolyInline() && a.PolySize() && b.PolySize();
+}
+
+// out = a + b, or a - b, lined up by their constant terms, degree by degree
+static inline void combineSmall(const int *a, unsigned na, const int *b, unsigned nb, int *out, bool subtract) {
+    unsigned n = na > nb ? na : nb;
+    for( unsigned d = 0; d < Small && d < n; d++ ) {
+        uint32_t x = d < na ? (uint32_t)a[na - 1 - d] : 0;
+        uint32_t y = d < nb ? (uint32_t)b[nb - 1 - d] : 0;
+        out[n - 1 - d] = (int)(subtract ? x - y : x + y);
+    }
+}
+
+// out = a * b, one term of the product at a time
+static inline void multiplySmall(const int *a, unsigned na, const int *b, unsigned nb, int *out) {
+    const uint32_t *x = reinterpret_cast<const uint32_t *>(a);
+    const uint32_t *y = reinterpret_cast<const uint32_t *>(b);
+    for( unsigned k = 0; k < 2 * Small - 1 && k < na + nb - 1; k++ ) {
+        unsigned lo = k < nb ? 0 : k - nb + 1;
+        unsigned hi = k < na ? k : na - 1;
+        uint32_t sum = 0;
+        for( unsigned i = lo; i <= hi; i++ )
+            sum += x[i] * y[k - i];
+        out[k] = (int)sum;
+    }
+}
+
+// the same for floats, in double and in the order PolyMultiply takes, the
+// longer operand outermost, so every sum rounds as it does there; the
+// scratch vectors it makes are what is saved
+static inline void multiplySmall(const Value& a, const Value& b, float *out) {
+    double x[Small], y[Small], acc[2 * Small - 1];
+    unsigned na = a.PolySize(), nb = b.PolySize();
+    for( unsigned k = 0; k < Small && k < na; k++ )
+        x[k] = floatAt(a, k);
+    for( unsigned k = 0; k < Small && k < nb; k++ )
+        y[k] = floatAt(b, k);
+    const double *outer = x, *inner = y;
+    unsigned no = na, ni = nb;
+    if( na < nb ) {
+        swap(outer, inner);
+        swap(no, ni);
+    }
+    for( unsigned k = 0; k < 2 * Small - 1; k++ )
+        acc[k] = 0;
+    for( unsigned i = 0; i < no; i++ )
+        for( unsigned j = 0; j < ni; j++ )
+            acc[i + j] += outer[i] * inner[j];
+    for( unsigned k = 0; k < na + nb - 1; k++ )
+        out[k] = (float)acc[k];
+}
+
+// combinePolys when both are int polynomials
+static Value combineIntPolys(const Value& a, const Value& b, bool subtract) {
+    unsigned n = a.PolySize() > b.PolySize() ? a.PolySize() : b.PolySize();
+    unsigned oa = n - a.PolySize();
+    unsigned ob = n - b.PolySize();
+    Value r = Value::Poly(n, false);
+    const int *ai = a.PolyInts();
+    const int *bi = b.PolyInts();
+    int *out = r.PolyInts();
+    if( bothSmall(a, b) ) {
+        combineSmall(ai, a.PolySize(), bi, b.PolySize(), out, subtract);
+        return r;
+    }
+    for( unsigned k = 0; k < n; k++ ) {
+        if( k < oa )
+            out[k] = subtract ? -bi[k - ob] : bi[k - ob];
+        else if( k < ob )
+            out[k] = ai[k - oa];
+        else
+            out[k] = subtract ? ai[k - oa] - bi[k - ob] : ai[k - oa] + bi[k - ob];
+    }
+    return r;
+}
+
+// a + b, or a - b when subtract is set. the shorter polynomial lines up with
+// the constant term of the longer one
+static Value combinePolys(const Value& a, const Value& b, bool subtract) {
+    if( !a.PolyIsFloat() && !b.PolyIsFloat() )
+        return combineIntPolys(a, b, subtract);
+
+    unsigned n = a.PolySize() > b.PolySize() ? a.PolySize() : b.PolySize();
+    unsigned oa = n - a.PolySize();
+    unsigned ob = n - b.PolySize();
+    // the degrees only an int polynomial has stay ints
+    if( a.PolyMixed() || b.PolyMixed() || (!a.PolyIsFloat() && ob > 0) || (!b.PolyIsFloat() && oa > 0) ) {
+        vector<Coefficient> out(n);
+        for( unsigned k = 0; k < n; k++ ) {
+            if( k < oa )
+                out[k] = subtract ? -Coefficient::At(b, k - ob) : Coefficient::At(b, k - ob);
+            else if( k < ob )
+                out[k] = Coefficient::At(a, k - oa);
+            else
+                out[k] = Coefficient::At(a, k - oa).Combine(Coefficient::At(b, k - ob), subtract);
+        }
+        return fromCoefficients(out);
+    }
+
+    Value r = Value::Poly(n, true);
+    float *out = r.PolyFloats();
+    for( unsigned k = 0; k < n; k++ ) {
+        if( k < oa )
+            out[k] = subtract ? -floatAt(b, k - ob) : floatAt(b, k - ob);
+        else if( k < ob )
+            out[k] = floatAt(a, k - oa);
+        else
+            out[k] = subtract ? floatAt(a, k - oa) - floatAt(b, k - ob) : floatAt(a, k - oa) + floatAt(b, k - ob);
+    }
+    return r;
+}
+
+// one step of SumPolys: s = a + s, or a - s when subtract is set, where the
+// sum so far s is the m coefficients ending at end and a is a term of na.
+// this is combinePolys done in place: the degrees both have are combined,
+// those only a has are copied and those only s has are negated for a
+// subtraction. ints are summed as uint32_t, which wraps as int does.
+// returns the size of the new sum
+template<class C, class A>
+static inline unsigned sumStep(C *end, unsigned m, const A *a, unsigned na, bool subtract) {
+    unsigned both = na < m ? na : m;
+    C *s = end - both;
+    const A *x = a + na - both;
+    if( subtract ) {
+        for( unsigned k = 0; k < both; k++ )
+            s[k] = (C)x[k] - s[k];
+    } else {
+        for( unsigned k = 0; k < both; k++ )
+            s[k] = (C)x[k] + s[k];
+    }
+    if( na > m ) {
+        C *out = end - na;
+        for( unsigned k = 0; k < na - m; k++ )
+            out[k] = (C)a[k];
+        return na;
+    }
+    if( subtract ) {
+        C *out = end - m;
+        for( unsigned k = 0; k < m - both; k++ )
+            out[k] = -out[k];
+    }
+    return m;
+}
+
+// the sum of the int polynomials t[0..n-1], grouped from the right, into
+// out, which has room for the longest of them
+static void sumInts(const Value *t, const int *signs, unsigned n, int *out, unsigned size) {
+    uint32_t *end = reinterpret_cast<uint32_t *>(out) + size;
+    unsigned m = 0;
+    for( unsigned k = n; k-- > 0; )
+        m = sumStep(end, m, t[k].PolyInts(), t[k].PolySize(), k + 1 < n && signs[k] < 0);
+}
+
+// the terms are taken from the innermost out. a sum of int polynomials, or
+// of float ones, is made in one block. one with both, or with a mixed term,
+// can keep some ints among its floats, so it is left to the operators
+Value Value::SumPolys(const Value *t, const int *signs, unsigned n) {
+    unsigned size = 0;
+    unsigned floats = 0;
+    bool mixed = false;
+    for( unsigned k = 0; k < n; k++ ) {
+        if( t[k].PolySize() > size )
+            size = t[k].PolySize();
+        floats += t[k].PolyIsFloat();
+        mixed = mixed || t[k].PolyMixed();
+    }
+    if( floats == 0 ) {
+        Value r = Poly(size, false);
+        sumInts(t, signs, n, r.PolyInts(), size);
+        return r;
+    }
+    if( floats < n || mixed ) {
+        Value r = t[n-1];
+        for( unsigned k = n - 1; k-- > 0; )
+            r = combinePolys(t[k], r, signs[k] < 0);
+        return r;
+    }
+
+    Value r = Poly(size, true);
+    float *end = r.PolyFloats() + size;
+    unsigned m = 0;
+    for( unsigned k = n; k-- > 0; )
+        m = sumStep(end, m, t[k].PolyFloats(), t[k].PolySize(), k + 1 < n && signs[k] < 0);
+    return r;
+}
+
+// a copy of p (negated when negate is set) with op applied to the constant
+// term: c + x when add is set, otherwise c - x, or x - c when negate is set
+static Value shiftConstant(const Value& p, const Value& x, bool add, bool negate) {
+    bool isFloat = p.PolyIsFloat() || x.GetType() == FLOATVAL;
+    unsigned n = p.PolySize();
+    // a float constant leaves the rest of an int polynomial ints
+    if( n > 0 && (p.PolyMixed() || (!p.PolyIsFloat() && isFloat && n > 1)) ) {
+        vector<Coefficient> out(n);
+        for( unsigned k = 0; k < n; k++ )
+            out[k] = negate ? -Coefficient::At(p, k) : Coefficient::At(p, k);
+        Coefficient c = Coefficient::At(p, n-1);
+        out[n-1] = negate ? Coefficient::Of(x).Combine(c, true) : c.Combine(Coefficient::Of(x), !add);
+        return fromCoefficients(out);
+    }
+    Value r = Value::Poly(n, isFloat);
+    if( n == 0 )
+        return r;
+
+    if( isFloat ) {
+        float *out = r.PolyFloats();
+        float xf = x.GetType() == FLOATVAL ? x.GetFloatValue() : (float)x.GetIntValue();
+        for( unsigned k = 0; k < n; k++ )
+            out[k] = negate ? -floatAt(p, k) : floatAt(p, k);
+        if( negate )
+            out[n-1] = xf - floatAt(p, n-1);
+        else
+            out[n-1] = add ? out[n-1] + xf : out[n-1] - xf;
+    } else {
+        int *out = r.PolyInts();
+        const int *in = p.PolyInts();
+        int xi = x.GetIntValue();
+        for( unsigned k = 0; k < n; k++ )
+            out[k] = negate ? -in[k] : in[k];
+        if( negate )
+            out[n-1] = xi - in[n-1];
+        else
+            out[n-1] = add ? out[n-1] + xi : out[n-1] - xi;
+    }
+    return r;
+}
+
+// shiftConstant done in p's own block, when nothing else shares it and the
+// coefficients stay the type they are; false when it cannot be
+static bool shiftInPlace(Value& p, const Value& x, bool add, bool negate) {
+    if( !p.PolyUnique() || p.PolyMixed() || (!p.PolyIsFloat() && x.GetType() == FLOATVAL) )
+        return false;
+    unsigned n = p.PolySize();
+    if( n == 0 )
+        return true;
+
+    if( p.PolyIsFloat() ) {
+        float *c = p.PolyFloats();
+        float xf = x.GetType() == FLOATVAL ? x.GetFloatValue() : (float)x.GetIntValue();
+        if( negate ) {
+            for( unsigned k = 0; k < n - 1; k++ )
+                c[k] = -c[k];
+            c[n-1] = xf - c[n-1];
+        } else
+            c[n-1] = add ? c[n-1] + xf : c[n-1] - xf;
+    } else {
+        int *c = p.PolyInts();
+        int xi = x.GetIntValue();
+        if( negate ) {
+            for( unsigned k = 0; k < n - 1; k++ )
+                c[k] = -c[k];
+            c[n-1] = xi - c[n-1];
+        } else
+            c[n-1] = add ? c[n-1] + xi : c[n-1] - xi;
+    }
+    return true;
+}
+
+// p with every coefficient multiplied by the scalar x
+static Value scalePoly(const Value& p, const Value& x) {
+    bool isFloat = p.PolyIsFloat() || x.GetType() == FLOATVAL;
+    unsigned n = p.PolySize();
+    if( p.PolyMixed() && x.GetType() == INTEGERVAL ) {
+        vector<Coefficient> out(n);
+        for( unsigned k = 0; k < n; k++ )
+            out[k] = Coefficient::At(p, k) * Coefficient::Of(x);
+        return fromCoefficients(out);
+    }
+    Value r = Value::Poly(n, isFloat);
+    if( isFloat ) {
+        float xf = x.GetType() == FLOATVAL ? x.GetFloatValue() : (float)x.GetIntValue();
+        float *out = r.PolyFloats();
+        for( unsigned k = 0; k < n; k++ )
+            out[k] = floatAt(p, k) * xf;
+    } else {
+        unsigned xi = (unsigned)x.GetIntValue();
+        const int *in = p.PolyInts();
+        int *out = r.PolyInts();
+        for( unsigned k = 0; k < n; k++ )
+            out[k] = (int)((unsigned)in[k] * xi);
+    }
+    return r;
+}
+
+static Value multiplyIntPolys(const Value& a, const Value& b) {
+    Value r = Value::Poly(a.PolySize() + b.PolySize() - 1, false);
+    if( bothSmall(a, b) )
+        multiplySmall(a.PolyInts(), a.PolySize(), b.PolyInts(), b.PolySize(), r.PolyInts());
+    else
+        PolyMultiply(a.PolyInts(), a.PolySize(), b.PolyInts(), b.PolySize(), r.PolyInts());
+    return r;
+}
+
+// the terms of a product of a and b that some float coefficient has a part
+// in, the rest being made of ints alone, and the product of those ints,
+// which is exact in the terms made of nothing else
+static Value keepIntTerms(const Value& a, const Value& b, const Value& product) {
+    unsigned na = a.PolySize(), nb = b.PolySize(), n = na + nb - 1;
+    // a float coefficient of a at i has a part in terms i to i + nb - 1;
+    // count where each such run starts and ends
+    vector<int> runs(n + 1);
+    for( unsigned i = 0; i < na; i++ )
+        if( !a.IsIntAt(i) ) { runs[i]++; runs[i + nb]--; }
+    for( unsigned j = 0; j < nb; j++ )
+        if( !b.IsIntAt(j) ) { runs[j]++; runs[j + na]--; }
+    bool anyInt = false;
+    for( unsigned k = 0, depth = 0; k < n; k++ ) {
+        depth += runs[k];
+        runs[k] = depth;
+        anyInt = anyInt || depth == 0;
+    }
+    if( !anyInt )
+        return product;
+
+    vector<int> ia(na), ib(nb), ints(n);
+    for( unsigned i = 0; i < na; i++ )
+        ia[i] = a.IsIntAt(i) ? a.IntAt(i) : 0;
+    for( unsigned j = 0; j < nb; j++ )
+        ib[j] = b.IsIntAt(j) ? b.IntAt(j) : 0;
+    PolyMultiply(&ia[0], na, &ib[0], nb, &ints[0]);
+    Value r = Value::MixedPoly(n);
+    float *out = r.PolyFloats();
+    for( unsigned k = 0; k < n; k++ ) {
+        if( runs[k] == 0 )
+            r.SetInt(k, ints[k]);
+        else
+            out[k] = product.PolyFloats()[k];
+    }
+    return r;
+}
+
+// the product of two polynomials, float if either one is. with a mixed one,
+// the terms made only of its ints stay ints
+static Value multiplyPolys(const Value& a, const Value& b) {
+    if( !a.PolyIsFloat() && !b.PolyIsFloat() )
+        return multiplyIntPolys(a, b);
+
+    Value r = Value::Poly(a.PolySize() + b.PolySize() - 1, true);
+    if( bothSmall(a, b) ) {
+        multiplySmall(a, b, r.PolyFloats());
+        return r;
+    }
+    vector<float> fa(a.PolySize()), fb(b.PolySize());
+    for( unsigned k = 0; k < a.PolySize(); k++ )
+        fa[k] = floatAt(a, k);
+    for( unsigned k = 0; k < b.PolySize(); k++ )
+        fb[k] = floatAt(b, k);
+    PolyMultiply(&fa[0], a.PolySize(), &fb[0], b.PolySize(), r.PolyFloats());
+    if( a.PolyMixed() || b.PolyMixed() )
+        return keepIntTerms(a, b, r);
+    return r;
+}
+
+Value Value::Add(Value&& a, Value&& b) {
+    bool scalarB = b.t == INTEGERVAL || b.t == FLOATVAL;
+    if( a.t == POLYVAL && scalarB && shiftInPlace(a, b, true, false) )
+        return std::move(a);
+    // a float plus a polynomial is an error, left to operator+
+    if( b.t == POLYVAL && a.t == INTEGERVAL && shiftInPlace(b, a, true, false) )
+        return std::move(b);
+    return a + b;
+}
+
+Value Value::Subtract(Value&& a, Value&& b) {
+    bool scalarB = b.t == INTEGERVAL || b.t == FLOATVAL;
+    if( a.t == POLYVAL && scalarB && shiftInPlace(a, b, false, false) )
+        return std::move(a);
+    if( b.t == POLYVAL && a.t == INTEGERVAL && shiftInPlace(b, a, false, true) )
+        return std::move(b);
+    return a - b;
+}
+
+Value Value::AddIntPolys(const Value& a, const Value& b) { return combineIntPolys(a, b, false); }
+Value Value::SubtractIntPolys(const Value& a, const Value& b) { return combineIntPolys(a, b, true); }
+Value Value::MultiplyIntPolys(const Value& a, const Value& b) { return multiplyIntPolys(a, b); }
+
+Value Value::operator+(const Value& op) const {
+    if( t == INTEGERVAL ) {
+        if( op.t == INTEGERVAL )
+            return Value(i + op.i);
+        else if( op.t == FLOATVAL )
+            return Value((float)i + op.f);
+        else if( op.t == POLYVAL )
+            return shiftConstant(op, *this, true, false);
+    } else if( t == FLOATVAL ) {
+        if( op.t == INTEGERVAL )
+            return Value(f + (float)op.i);
+        else if( op.t == FLOATVAL )
+            return Value(f + op.f);
+    } else if( t == STRINGVAL ) {
+        if( op.t == STRINGVAL ) {
+            ++s->refs;
+            ++op.s->refs;
+            return Value(StringRep::Concat(s, op.s));
+        }
+    } else if( t == POLYVAL ) {
+        if( op.t == POLYVAL )
+            return combinePolys(*this, op, false);
+        else if( op.t == INTEGERVAL || op.t == FLOATVAL )
+            return shiftConstant(*this, op, true, false);
+    }
+    return Value();
+}
+
+Value Value::operator-(const Value& op) const {
+    if( t == INTEGERVAL ) {
+        if( op.t == INTEGERVAL )
+            return Value(i - op.i);
+        else if( op.t == FLOATVAL )
+            return Value((float)i - op.f);
+        else if( op.t == POLYVAL )
+            return shiftConstant(op, *this, false, true);
+    } else if( t == FLOATVAL ) {
+        if( op.t == FLOATVAL )
+            return Value(f - op.f);
+        else if( op.t == INTEGERVAL )
+            return Value(f - (float)op.i);
+    } else if( t == POLYVAL ) {
+        if( op.t == POLYVAL )
+            return combinePolys(*this, op, true);
+        else if( op.t == INTEGERVAL || op.t == FLOATVAL )
+            return shiftConstant(*this, op, false, false);
+    }
+    return Value();
+}
+
+Value Value::operator*(const Value& op) const {
+    if( t == INTEGERVAL ) {
+        if( op.t == FLOATVAL )
+            return Value((float)i * op.f);
+        else if( op.t == INTEGERVAL )
+            return Value(i * op.i);
+        else if( op.t == POLYVAL )
+            return scalePoly(op, *this);
+    } else if( t == FLOATVAL ) {
+        if( op.t == FLOATVAL )
+            return Value(f * op.f);
+        else if( op.t == INTEGERVAL )
+            return Value(f * (float)op.i);
+        else if( op.t == POLYVAL )
+            return scalePoly(op, *this);
+    } else if( t == POLYVAL ) {
+        if( op.t == POLYVAL )
+            return multiplyPolys(*this, op);
+        else if( op.t == INTEGERVAL || op.t == FLOATVAL )
+            return scalePoly(*this, op);
+    } else if( t == STRINGVAL ) {
+        if( op.t == INTEGERVAL ) {
+            ++s->refs;
+            return Value(StringRep::Repeat(s, op.i > 0 ? (size_t)op.i : 0));
+        }
+    }
+    return Value();
+}
+
+Output &operator<<( Output &output, const Value &v ) {
+    if( v.t == INTEGERVAL ) {
+        output << v.i;
+    } else if( v.t == STRINGVAL ) {
+        v.s->Write(output);
+    } else if( v.t == FLOATVAL ) {
+        output << v.f;
+    } else if( v.t == POLYVAL || v.t == LISTVAL ) {
+        output << (v.t == POLYVAL ? "{ " : "[ ");
+        for( unsigned k = 0; k < v.PolySize(); k++ ) {
+            if( v.IsIntAt(k) )
+                output << v.IntAt(k);
+            else
+                output << v.PolyFloats()[k];
+            if( k != v.PolySize() - 1 )
+                output << ", ";
+        }
+        output << (v.t == POLYVAL ? " }" : " ]");
+    } else
+        return output;
+    output.EndLine();
+    return output;
+}
+
+ostream &operator<<( ostream &output, const Value &v ) {
+    Output o(output, 256);
+    o << v;
+    return output;
+}
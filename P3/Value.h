@@ -0,0 +1,374 @@
+/*
+ * Value.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef VALUE_H_
+#define VALUE_H_
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+class Output;
+
+// objects in the language have one of these types
+enum Type {
+	INTEGERVAL,
+	FLOATVAL,
+	STRINGVAL,
+    POLYVAL,
+    LISTVAL,
+	UNKNOWNVAL,
+};
+
+// the coefficients of a polynomial, highest degree first, in one contiguous
+// block. usually every coefficient has the same type: all int or all float.
+// a polynomial written with both, like { 1000000, 1.5 }, keeps each one's
+// type, so the ints still print as ints: it is mixed, and is stored as a
+// float polynomial, so whatever reads it as floats need not know, with the
+// exact value of each int coefficient and a flag for each coefficient after
+// the floats. a list (the values of a polynomial at several points) is
+// stored the same way, but never mixed. a block is shared by every Value
+// copied from the one that made it; refs counts them. the count is not
+// atomic, as no Value is shared between threads
+struct PolyRep {
+    unsigned	size;
+    unsigned	refs;
+    bool		isFloat;
+    bool		mixed;
+    bool		inRegion;	// taken from valueRegion rather than the heap
+    union {
+        int		i[1];
+        float	f[1];
+    } c;
+
+    int *ints() { return c.i; }
+    float *floats() { return c.f; }
+    const int *ints() const { return c.i; }
+    const float *floats() const { return c.f; }
+    // mixed: the int coefficients, and which coefficients they are
+    int *exact() { return c.i + size; }
+    unsigned char *intFlags() { return reinterpret_cast<unsigned char *>(c.i + 2 * size); }
+    const int *exact() const { return c.i + size; }
+    const unsigned char *intFlags() const { return reinterpret_cast<const unsigned char *>(c.i + 2 * size); }
+
+    static size_t Bytes(unsigned size, bool mixed);
+    static PolyRep *Make(unsigned size, bool isFloat, bool mixed = false);
+    static PolyRep *Copy(const PolyRep *p);
+    static void Free(PolyRep *p);
+};
+
+// the characters of a string: a run of text, two strings one after the
+// other, or one string repeated count times. a node is never changed once
+// made, so + and * make a new node over their operands' nodes rather than
+// copying characters, and the characters are only visited when the string
+// is printed. like PolyRep, a node is shared by every Value and node that
+// holds it, refs counting them. a string built up over many statements can
+// be a very deep tree, so nothing walks one recursively
+struct StringRep {
+    enum Kind { TEXT, CONCAT, REPEAT };
+
+    unsigned	refs;
+    Kind		kind;
+    size_t		length;		// of the whole string
+    StringRep	*first;		// CONCAT: the first part; REPEAT: what is repeated
+    StringRep	*second;	// CONCAT: the second part
+    size_t		count;		// REPEAT
+    char		text[1];	// TEXT: length characters
+
+    static StringRep *Text(const char *s, size_t n);
+    // these take over a reference to each operand
+    static StringRep *Concat(StringRep *a, StringRep *b);
+    static StringRep *Repeat(StringRep *a, size_t count);
+    static void Release(StringRep *s) {
+        if( --s->refs == 0 )
+            s->free();
+    }
+
+    // the characters to out, a piece at a time, with no copy of the whole
+    void Write(Output& out) const;
+    std::string Flatten() const;
+    // the first n characters, or the whole string if it is shorter
+    std::string Prefix(size_t n) const;
+    // append the nodes and their text to sig, so strings that append the
+    // same are equal, without flattening; false if there are more than
+    // limit nodes to visit
+    bool AppendShape(std::string& sig, size_t limit) const;
+
+private:
+    void free();
+};
+
+// heap blocks made for strings and polynomials on this thread, the
+// coefficients in them and their size, for --stats and --profile. counting
+// is a few adds, so it is always on
+struct AllocCounts {
+    unsigned long	blocks;
+    unsigned long	coefficients;
+    unsigned long	bytes;
+};
+extern thread_local AllocCounts valueAllocs;
+
+// the blocks of the polynomials a statement makes while it runs are taken
+// from here, by moving a pointer, and all given back at once when the
+// statement is done, rather than each going through malloc and free. a value
+// that is to outlive its statement, as one stored in a variable does, is
+// copied out to the heap by Keep. blocks of more than BigBlock bytes, and
+// any made outside a statement, always come from the heap. the chunks are
+// kept from one statement to the next, so they come to the most any one
+// statement needed at once. it has no constructor, so being thread local
+// costs nothing on each use; everything starts at zero
+class ValueRegion {
+    struct Chunk {
+        Chunk	*next;
+    };
+    static const size_t ChunkBytes = 256 * 1024;
+
+    Chunk	*first;
+    Chunk	*current;
+    char	*top;
+    char	*end;
+    size_t	before;		// bytes in use in the chunks before current
+
+    static char *start(Chunk *c) { return reinterpret_cast<char *>(c + 1); }
+    void *grow(size_t bytes);
+
+public:
+    static const size_t BigBlock = 16 * 1024;
+
+    bool			active;			// inside a statement
+    unsigned long	blocks;			// taken from the region
+    unsigned long	bytes;
+    unsigned long	kept;			// copied out to the heap by Keep
+    unsigned long	keptBytes;
+    unsigned long	statements;		// resets
+    size_t			peak;			// the most bytes one statement took
+    size_t			reserved;		// in the chunks held
+
+    // room for bytes, or 0 when the block is to come from the heap
+    void *Allocate(size_t n) {
+        if( !active || n > BigBlock )
+            return 0;
+        n = (n + 7) & ~(size_t)7;
+        ++blocks;
+        bytes += n;
+        if( (size_t)(end - top) < n )
+            return grow(n);
+        void *p = top;
+        top += n;
+        return p;
+    }
+    // the statement is done, and every block it took with it
+    void Reset();
+    // give back the chunks too, once a whole program has run
+    void Release();
+    void ClearCounts() { blocks = bytes = kept = keptBytes = statements = peak = 0; }
+
+    // the region in use while a statement runs; no value taken from it may
+    // be alive once this is gone
+    class Statement {
+        ValueRegion& r;
+    public:
+        explicit Statement(ValueRegion& r) : r(r) { r.active = true; }
+        ~Statement() { r.Reset(); r.active = false; }
+    };
+};
+extern thread_local ValueRegion valueRegion;
+
+// the result of an evaluation: a tag and a payload. scalars never touch the
+// heap; a string shares its StringRep. a polynomial or list of up to
+// InlineTerms coefficients is held in the payload itself, so the short ones
+// most programs are made of never touch the heap either. a longer one is
+// immutable once made, so copying it only shares its block, and a block is
+// copied only when one of its owners asks to change it
+class Value {
+public:
+    static const unsigned InlineTerms = 4;
+
+private:
+	Type			t;
+    bool			inl;		// a polynomial or list held in ci or cf
+    bool			inlFloat;
+    unsigned char	inlSize;
+    union {
+        int			i;
+        float		f;
+        StringRep	*s;
+        PolyRep		*p;
+        int			ci[InlineTerms];
+        float		cf[InlineTerms];
+    };
+
+    void release() {
+        if( t == STRINGVAL ) StringRep::Release(s);
+        else if( (t == POLYVAL || t == LISTVAL) && !inl && --p->refs == 0 ) PolyRep::Free(p);
+    }
+    // the tag and the whole payload, whichever it holds
+    void take(const Value& v) {
+        t = v.t;
+        inl = v.inl;
+        inlFloat = v.inlFloat;
+        inlSize = v.inlSize;
+        memcpy(ci, v.ci, sizeof ci);
+    }
+    void copyFrom(const Value& v) {
+        take(v);
+        if( t == STRINGVAL )
+            ++s->refs;
+        else if( (t == POLYVAL || t == LISTVAL) && !inl )
+            ++p->refs;
+    }
+    Value(Type t, PolyRep *p) : t(t), inl(false), inlFloat(false), inlSize(0), p(p) {}
+    Value(StringRep *s) : t(STRINGVAL), inl(false), inlFloat(false), inlSize(0), s(s) {}
+    // size coefficients held inline, to be filled in
+    Value(Type t, unsigned size, bool isFloat) : t(t), inl(true), inlFloat(isFloat), inlSize(size) {}
+
+    void keep();
+
+    // make p this value's alone, before it is changed
+    void unshare() {
+        if( p->refs > 1 ) {
+            --p->refs;
+            p = PolyRep::Copy(p);
+        }
+    }
+
+public:
+	Value(int i) : t(INTEGERVAL), inl(false), inlFloat(false), inlSize(0), i(i) {}
+	Value(float f) : t(FLOATVAL), inl(false), inlFloat(false), inlSize(0), f(f) {}
+	Value(const std::string& s) : t(STRINGVAL), inl(false), inlFloat(false), inlSize(0), s(StringRep::Text(s.data(), s.size())) {}
+    Value() : t(UNKNOWNVAL), inl(false), inlFloat(false), inlSize(0), p(0) {}
+
+    Value(const Value& v) { copyFrom(v); }
+    Value(Value&& v) noexcept { take(v); v.t = UNKNOWNVAL; }
+    ~Value() { release(); }
+    Value& operator=(const Value& v) {
+        if( this != &v ) {
+            release();
+            copyFrom(v);
+        }
+        return *this;
+    }
+    Value& operator=(Value&& v) noexcept {
+        if( this != &v ) {
+            release();
+            take(v);
+            v.t = UNKNOWNVAL;
+        }
+        return *this;
+    }
+
+    // a polynomial with room for size coefficients, to be filled in by the caller
+    static Value Poly(unsigned size, bool isFloat) {
+        return size <= InlineTerms ? Value(POLYVAL, size, isFloat) : Value(POLYVAL, PolyRep::Make(size, isFloat));
+    }
+    // likewise a list of size elements
+    static Value List(unsigned size, bool isFloat) {
+        return size <= InlineTerms ? Value(LISTVAL, size, isFloat) : Value(LISTVAL, PolyRep::Make(size, isFloat));
+    }
+    // a mixed polynomial of size coefficients, all floats until SetInt makes
+    // one an int. it is never held inline
+    static Value MixedPoly(unsigned size) {
+        Value v(POLYVAL, PolyRep::Make(size, true, true));
+        memset(v.p->intFlags(), 0, size);
+        return v;
+    }
+    // coefficient k of a mixed polynomial made an int
+    void SetInt(unsigned k, int i) {
+        p->floats()[k] = (float)i;
+        p->exact()[k] = i;
+        p->intFlags()[k] = 1;
+    }
+
+    Value operator+(const Value& op) const;
+    Value operator-(const Value& op) const;
+    Value operator*(const Value& op) const;
+
+    // a + b and a - b for operands the caller has no further use for. when a
+    // scalar is added to a polynomial that shares its block with nothing,
+    // only the constant term is changed, where it is
+    static Value Add(Value&& a, Value&& b);
+    static Value Subtract(Value&& a, Value&& b);
+
+    // the operators for two int polynomials, for callers that already know
+    // that is what they have
+    static Value AddIntPolys(const Value& a, const Value& b);
+    static Value SubtractIntPolys(const Value& a, const Value& b);
+    static Value MultiplyIntPolys(const Value& a, const Value& b);
+
+    // t[0] op t[1] op ... op t[n-1] for n >= 2 polynomials, grouped from the
+    // right as the parser builds it, op being + or - as signs[k] is 1 or -1
+    // for the one after t[k]. the result is made in one block, not one per
+    // operator, with every coefficient just as the operators would give it
+    static Value SumPolys(const Value *t, const int *signs, unsigned n);
+
+    Type GetType() const { return t; }
+    int GetIntValue() const { return t == INTEGERVAL ? i : 0; }
+    float GetFloatValue() const { return t == FLOATVAL ? f : 0; }
+    // the whole string, flattened; printing a string streams it instead
+    std::string GetStringValue() const { return t == STRINGVAL ? s->Flatten() : std::string(); }
+    const StringRep *GetStringRep() const { return t == STRINGVAL ? s : 0; }
+    // the payload, unchecked, of a value known to be an int or a float
+    int AsInt() const { return i; }
+    float AsFloat() const { return f; }
+
+    // these work on lists as well as polynomials. the ones that allow a
+    // change copy a block that is shared first
+    unsigned PolySize() const { return inl ? inlSize : p->size; }
+    bool PolyIsFloat() const { return inl ? inlFloat : p->isFloat; }
+    // whether some coefficients are ints and some floats. PolyFloats then
+    // gives every one as a float; these give each one as it was made
+    bool PolyMixed() const { return !inl && p->mixed; }
+    bool IsIntAt(unsigned k) const { return !PolyIsFloat() || (PolyMixed() && p->intFlags()[k]); }
+    int IntAt(unsigned k) const { return PolyMixed() ? p->exact()[k] : PolyInts()[k]; }
+    const int *PolyInts() const { return inl ? ci : p->ints(); }
+    const float *PolyFloats() const { return inl ? cf : p->floats(); }
+    int *PolyInts() {
+        if( inl ) return ci;
+        unshare();
+        return p->ints();
+    }
+    float *PolyFloats() {
+        if( inl ) return cf;
+        unshare();
+        return p->floats();
+    }
+    // whether the coefficients are held in the value itself. a pointer to
+    // them lasts only as long as the value stays where it is
+    bool PolyInline() const { return inl; }
+    // whether this is the only value with its coefficients, so changing them
+    // in place cannot be seen anywhere else
+    bool PolyUnique() const { return inl || p->refs == 1; }
+
+    // move a block taken from valueRegion to the heap, for a value that is to
+    // outlive the statement that made it
+    void Keep() {
+        if( (t == POLYVAL || t == LISTVAL) && !inl && p->inRegion )
+            keep();
+    }
+
+    // the value as print shows it, ending the line
+    friend Output &operator<<( Output &output, const Value &v );
+    friend std::ostream &operator<<( std::ostream &output, const Value &v );
+};
+// every stack slot, variable and VM register holds one
+static_assert(sizeof(Value) <= 24, "Value is to stay within 24 bytes");
+
+// what static type inference can tell of a value before the program runs:
+// its type and, for a polynomial or a list, whether its coefficients are
+// floats. UNKNOWNVAL when only running it will tell
+struct StaticType {
+    Type	t;
+    bool	isFloat;
+
+    StaticType(Type t = UNKNOWNVAL, bool isFloat = false) : t(t), isFloat(isFloat) {}
+    static StaticType Of(const Value& v) {
+        Type t = v.GetType();
+        return StaticType(t, (t == POLYVAL || t == LISTVAL) && v.PolyIsFloat());
+    }
+    bool Known() const { return t != UNKNOWNVAL; }
+};
+
+#endif /* VALUE_H_ */
@@ -9,57 +9,243 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <chrono>
+#include <cstdlib>
 
 using namespace std;
 
 #include "ParseNode.h"
+#include "Batch.h"
+#include "Bench.h"
 
-int currentLine = 0;
-int globalErrorCount = 0;
+// lex the whole of source, returning the tokens up to and including DONE
+template<class Source> static vector<Token *> lexAll(Interpreter& interp, Source& source) {
+    vector<Token *> tokens;
+    interp.currentLine = 0;
+    while( true ) {
+        Token *t = getToken(interp, source);
+        tokens.push_back(t);
+        if( *t == DONE )
+            break;
+    }
+    return tokens;
+}
 
-map<string, bool > *IdentifierMap = new map<string, bool>();
-map<string, Value> *symb = new map<string, Value>();
+// the most --eval-cache and --jobs take; more is a typo, not a setting
+static const unsigned long MaxEvalCache = 1 << 20;
+static const unsigned long MaxJobs = 256;
+
+// s as a number of at most max, in digits only, as Bench.cpp reads its
+// settings; false if it is anything else
+static bool parseCount(const string& s, unsigned long max, unsigned long& v) {
+    if( s.empty() || s.size() > 10 || s.find_first_not_of("0123456789") != string::npos )
+        return false;
+    v = strtoul(s.c_str(), 0, 10);
+    return v <= max;
+}
+
+// time the istream lexer against the buffered one on the same file, and make
+// sure they agree on every token
+static int lexBench(const string& name) {
+    typedef chrono::steady_clock clock;
+    Interpreter interp;
+    
+    ifstream file(name, ios::binary);
+    SourceBuffer source;
+    if( !file.is_open() || !source.Open(name.c_str()) ) {
+        cout << "Could not open " << name << endl;
+        return 1;
+    }
+    
+    clock::time_point t0 = clock::now();
+    vector<Token *> streamed = lexAll(interp, file);
+    clock::time_point t1 = clock::now();
+    vector<Token *> buffered = lexAll(interp, source);
+    clock::time_point t2 = clock::now();
+    
+    double mb = source.BytesRead() / (1024.0 * 1024.0);
+    double s1 = chrono::duration<double>(t1 - t0).count();
+    double s2 = chrono::duration<double>(t2 - t1).count();
+    cout << "istream lexer:  " << streamed.size() << " tokens, " << s1 * 1000 << " ms, " << mb / s1 << " MB/s" << endl;
+    cout << "buffered lexer: " << buffered.size() << " tokens, " << s2 * 1000 << " ms, " << mb / s2 << " MB/s" << endl;
+    
+    for( size_t i = 0; i < streamed.size() && i < buffered.size(); i++ ) {
+        Token *a = streamed[i];
+        Token *b = buffered[i];
+        if( a->getType() != b->getType() || a->getLine() != b->getLine() || a->getLexeme() != b->getLexeme() ) {
+            cout << "lexers disagree at token " << i << " on line " << a->getLine() << endl;
+            return 1;
+        }
+    }
+    if( streamed.size() != buffered.size() ) {
+        cout << "lexers disagree on the number of tokens" << endl;
+        return 1;
+    }
+    return 0;
+}
 
 int
 main(int argc, char *argv[])
 {
-    ifstream file;
+    SourceBuffer file;
     bool use_stdin = true;
+    bool stream = false;
+    Interpreter::Options opts;
+    
+    // with --batch, --manifest or --jobs any number of files may be named
+    bool batch = false;
+    BatchOptions batchOpts;
+    vector<string> files;
     
     for( int i=1; i<argc; i++ ) {
         string arg = argv[i];
         
-        if( use_stdin == false ) {
-            cout << "Too many file names" << endl;
-            return 1;
+        if( arg == "--mem" ) {
+            opts.memReport = true;
+            continue;
         }
-        use_stdin = false;
-        
-        file.open(arg);
-        if( file.is_open() == false ) {
-            cout << "Could not open " << arg << endl;
-            return 1;
+        if( arg == "--vm" ) {
+            opts.useVM = true;
+            continue;
+        }
+        if( arg == "--stream" ) {
+            stream = true;
+            continue;
+        }
+        if( arg == "--line-buffered" ) {
+            opts.lineBuffered = true;
+            continue;
+        }
+        if( arg == "--stats" ) {
+            opts.stats = true;
+            continue;
+        }
+        if( arg == "--profile" && i + 1 < argc ) {
+            opts.profile = argv[++i];
+            continue;
         }
+        if( arg == "--profile-bytes" && i + 1 < argc ) {
+            opts.profileBytes = argv[++i];
+            continue;
+        }
+        if( arg == "--cse" ) {
+            opts.share = true;
+            continue;
+        }
+        if( arg == "--cse-report" ) {
+            opts.share = opts.shareReport = true;
+            continue;
+        }
+        if( arg == "--eval-cache" && i + 1 < argc ) {
+            unsigned long n;
+            if( !parseCount(argv[++i], MaxEvalCache, n) ) {
+                cout << "--eval-cache takes a number of entries up to " << MaxEvalCache << endl;
+                return 1;
+            }
+            opts.evalCache = n;
+            continue;
+        }
+        if( arg == "--specialize" ) {
+            opts.specialize = true;
+            continue;
+        }
+        if( arg == "--dump-folded" ) {
+            opts.dumpFolded = true;
+            continue;
+        }
+        if( arg == "--lex-bench" && i + 1 < argc ) {
+            return lexBench(argv[i+1]);
+        }
+        // the rest of the arguments are key=value settings for these two
+        if( arg == "--gen" || arg == "--bench" ) {
+            BenchOptions bench;
+            for( int j = i + 1; j < argc; j++ ) {
+                if( !bench.Set(argv[j]) ) {
+                    cout << "Bad setting " << argv[j] << endl;
+                    return 1;
+                }
+            }
+            if( arg == "--bench" )
+                return RunBenchmarks(cout, bench);
+            GenerateScript(cout, bench.shape);
+            return 0;
+        }
+        if( arg == "--batch" ) {
+            batch = true;
+            continue;
+        }
+        if( arg == "--manifest" && i + 1 < argc ) {
+            batch = true;
+            if( !ReadManifest(argv[++i], files) ) {
+                cout << "Could not open " << argv[i] << endl;
+                return 1;
+            }
+            continue;
+        }
+        if( arg == "--jobs" && i + 1 < argc ) {
+            batch = true;
+            unsigned long n;
+            if( !parseCount(argv[++i], MaxJobs, n) ) {
+                cout << "--jobs takes a number of threads up to " << MaxJobs << ", or 0 for one per core" << endl;
+                return 1;
+            }
+            batchOpts.jobs = (unsigned)n;
+            continue;
+        }
+        if( arg == "--out-dir" && i + 1 < argc ) {
+            batch = true;
+            batchOpts.outDir = argv[++i];
+            continue;
+        }
+        
+        files.push_back(arg);
     }
     
-    istream& in = use_stdin ? cin : file;
-
-    ParseNode *program = Prog(in);
-    
-    if( program == 0 || globalErrorCount > 0 ) {
-        cout << "Program failed!" << endl;
+    // sharing would be skipped, and --cse-report would print nothing
+    if( opts.share && !opts.Sharing() ) {
+        cout << "--cse cannot be used with " << (opts.useVM ? "--vm" : opts.stats ? "--stats" : !opts.profile.empty() ? "--profile" : "--profile-bytes") << endl;
+        return 1;
+    }
+    // the VM runs bytecode, which has no nodes to time, so the stacks
+    // would come out empty
+    if( opts.useVM && (!opts.profile.empty() || !opts.profileBytes.empty()) ) {
+        cout << (!opts.profile.empty() ? "--profile" : "--profile-bytes") << " cannot be used with --vm" << endl;
         return 1;
     }
     
-    program->RunStaticChecks(*IdentifierMap);
-    program->Eval(*symb);
+    if( batch ) {
+        // every script would write over the others' stacks
+        if( !opts.profile.empty() || !opts.profileBytes.empty() ) {
+            cout << "--profile takes a single script" << endl;
+            return 1;
+        }
+        batchOpts.run = opts;
+        batchOpts.stream = stream;
+        return RunBatch(files, batchOpts);
+    }
     
-    if( globalErrorCount > 0 ) {
-        cout << "Program failed!" << endl;
+    if( files.size() > 1 ) {
+        cout << "Too many file names" << endl;
         return 1;
     }
+    if( files.size() == 1 ) {
+        use_stdin = false;
+        if( file.Open(files[0].c_str()) == false ) {
+            cout << "Could not open " << files[0] << endl;
+            return 1;
+        }
+    }
     
-    return 0;
+    // a stream reads stdin as it arrives rather than in whole blocks
+    SourceBuffer stdinSource(cin);
+    SourceBuffer stdinStream(0);
+    SourceBuffer& in = !use_stdin ? file : stream ? stdinStream : stdinSource;
+
+    // the program, its variables and everything parsed for it live here
+    Interpreter interp(cout);
+    if( stream )
+        return interp.RunStream(in, opts);
+    return interp.Run(in, opts);
 }
 
 
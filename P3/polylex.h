@@ -10,10 +10,7 @@
 
 #include <istream>
 #include <string>
-
-extern int	currentLine;	// in ONE PLACE in your program, you must have the following line:
-							// int currentLine = 0;
-							// each time you see a '\n', add one to currentLine
+#include <cstring>
 
 enum TokenTypes {
 	ID,
@@ -38,29 +35,46 @@ enum TokenTypes {
     ERR,
 };
 
+// a token's lexeme is not copied: text points into the source buffer (or
+// into the program arena) and is not NUL terminated
 class Token {
 private:
 	TokenTypes	t;
-	std::string	lexeme;
+	const char	*text;
+	unsigned	len;
 	int			line;
 
 public:
-	Token(TokenTypes t=ERR, std::string lexeme="") {
+	Token(TokenTypes t=ERR, const char *text="", int line=0) {
+		this->t = t;
+		this->text = text;
+		this->len = (unsigned)strlen(text);
+		this->line = line;
+	}
+	Token(TokenTypes t, const char *text, unsigned len, int line) {
 		this->t = t;
-		this->lexeme = lexeme;
-		this->line = currentLine;
-//        cout << "NEW TOKEN : " << currentLine << "| LEX: " << lexeme <<  "| TYPE: " << TokenTypes(t) << "      "<< endl;
+		this->text = text;
+		this->len = len;
+		this->line = line;
 	}
 
 	TokenTypes getType() const { return t; }
-	std::string getLexeme() const { return lexeme; }
+	std::string getLexeme() const { return std::string(text, len); }
+	const char *getText() const { return text; }
+	unsigned getLength() const { return len; }
 	int getLine() const { return line; }
 
 	bool operator==(const TokenTypes& tt) { return t == tt; }
 	bool operator!=(const TokenTypes& tt) { return t != tt; }
 };
 
-extern Token *getToken(std::istream& source);
+class SourceBuffer;
+class Interpreter;
+
+// the next token of source. the line count and the memory for tokens belong
+// to interp
+extern Token *getToken(Interpreter& interp, std::istream& source);
+extern Token *getToken(Interpreter& interp, SourceBuffer& source);
 
 
 
@@ -0,0 +1,166 @@
+/*
+ * ParallelTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+// runs scripts one by one, each in a fresh Interpreter, and then again on
+// many threads at once, every thread with Interpreters of its own and the
+// scripts in an order of its own, and checks that every run prints what the
+// one by one run did. an Interpreter shares nothing with another, so any
+// difference is a bug. the scripts are the files named, and as many as
+// --generate asks for made by GenerateScript, 16 if no file is named.
+//
+// build and run from P3/:
+//   g++ -std=gnu++11 -O2 -pthread -I. -o parallel-test tests/ParallelTest.cpp $(ls *.cpp | grep -v main.cpp)
+//   ./parallel-test *.txt
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include "Interpreter.h"
+#include "SourceBuffer.h"
+#include "Bench.h"
+
+using namespace std;
+
+// what one script printed, on each stream, and how it ended
+struct Result {
+    string	out;
+    string	err;
+    int		status;
+
+    bool operator==(const Result& r) const { return out == r.out && err == r.err && status == r.status; }
+    bool operator!=(const Result& r) const { return !(*this == r); }
+};
+
+// the ways a script is run, each checked on its own
+struct Mode {
+    const char	*name;
+    bool		useVM;
+    bool		stream;
+};
+static const Mode modes[] = {
+    { "tree", false, false },
+    { "vm", true, false },
+    { "stream", false, true },
+};
+static const size_t modeCount = sizeof modes / sizeof modes[0];
+
+// a file, or the text of a generated script
+struct Script {
+    string	name;
+    string	text;
+    bool	generated;
+};
+
+static Result run(const Script& script, const Mode& mode) {
+    Result r;
+    ostringstream out, err;
+    istringstream text(script.text);
+    SourceBuffer generated(text);
+    SourceBuffer file;
+    if( !script.generated && file.Open(script.name.c_str()) == false ) {
+        r.status = -1;
+        return r;
+    }
+    SourceBuffer& in = script.generated ? generated : file;
+    {
+        Interpreter interp(out, err);
+        Interpreter::Options opts;
+        opts.useVM = mode.useVM;
+        r.status = mode.stream ? interp.RunStream(in, opts) : interp.Run(in, opts);
+    }
+    r.out = out.str();
+    r.err = err.str();
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned threads = 8, rounds = 4;
+    int generate = -1;
+    vector<Script> files;
+    for( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+        if( arg == "--threads" && i + 1 < argc )
+            threads = (unsigned)atoi(argv[++i]);
+        else if( arg == "--rounds" && i + 1 < argc )
+            rounds = (unsigned)atoi(argv[++i]);
+        else if( arg == "--generate" && i + 1 < argc )
+            generate = atoi(argv[++i]);
+        else {
+            Script s = { arg, "", false };
+            files.push_back(s);
+        }
+    }
+    if( generate < 0 )
+        generate = files.empty() ? 16 : 0;
+    for( int k = 0; k < generate; k++ ) {
+        ScriptShape shape;
+        shape.seed = k + 1;
+        shape.statements = 500;
+        ostringstream text;
+        GenerateScript(text, shape);
+        ostringstream name;
+        name << "generated script " << shape.seed;
+        Script s = { name.str(), text.str(), true };
+        files.push_back(s);
+    }
+    if( files.empty() || threads == 0 ) {
+        cerr << "usage: parallel-test [--threads n] [--rounds n] [--generate n] script..." << endl;
+        return 2;
+    }
+
+    // the results to expect, by file and mode
+    vector<Result> expected(files.size() * modeCount);
+    for( size_t f = 0; f < files.size(); f++ ) {
+        for( size_t m = 0; m < modeCount; m++ ) {
+            expected[f * modeCount + m] = run(files[f], modes[m]);
+            if( expected[f * modeCount + m].status < 0 ) {
+                cerr << "Could not open " << files[f].name << endl;
+                return 2;
+            }
+        }
+    }
+
+    atomic<unsigned long> runs(0), mismatches(0);
+    mutex reportLock;
+    vector<thread> pool;
+    for( unsigned t = 0; t < threads; t++ ) {
+        pool.push_back(thread([&, t]() {
+            // each thread shuffles the runs its own way every round, so the
+            // threads overlap on different scripts each time
+            vector<size_t> order(expected.size());
+            for( size_t i = 0; i < order.size(); i++ )
+                order[i] = i;
+            mt19937 rnd(t);
+            for( unsigned round = 0; round < rounds; round++ ) {
+                shuffle(order.begin(), order.end(), rnd);
+                for( size_t k = 0; k < order.size(); k++ ) {
+                    size_t i = order[k];
+                    Result r = run(files[i / modeCount], modes[i % modeCount]);
+                    ++runs;
+                    if( r != expected[i] ) {
+                        ++mismatches;
+                        lock_guard<mutex> g(reportLock);
+                        cerr << "thread " << t << ": " << files[i / modeCount].name << " (" << modes[i % modeCount].name
+                            << ") printed\n" << r.out << "instead of\n" << expected[i].out;
+                    }
+                }
+            }
+        }));
+    }
+    for( size_t t = 0; t < pool.size(); t++ )
+        pool[t].join();
+
+    cout << runs << " runs of " << files.size() << " scripts on " << threads << " threads, "
+        << mismatches << " differed from the run on one thread" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
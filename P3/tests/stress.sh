@@ -0,0 +1,56 @@
+#!/bin/sh
+#
+# stress.sh
+#
+#  Created on: Oct 18, 2026
+#
+# long scripts and long expressions must run in a small, flat stack: the
+# parser and the tree walks loop rather than recurse. each script here is
+# generated, run under a 256 KB stack and its output checked.
+#
+# run from P3/, with the interpreter built as ./p3 or named as the argument:
+#   g++ -std=gnu++11 -O2 -pthread -o p3 *.cpp && sh tests/stress.sh ./p3
+
+P3=${1:-./p3}
+STACK=256
+failed=0
+
+# run $P3 with the options in $2 on what stdin gives it, and compare what it
+# prints with $3
+check() {
+    got=$( (ulimit -s $STACK && "$P3" $2) 2>&1 )
+    if [ "$got" = "$3" ]; then
+        echo "ok   $1"
+    else
+        echo "FAIL $1: expected '$3', got '$(echo "$got" | head -c 200)'"
+        failed=1
+    fi
+}
+
+# n statements that each add 1 to x
+statements() {
+    awk -v n="$1" 'BEGIN { print "set x 0;"; for( i = 0; i < n; i++ ) print "set x x + 1;"; print "print x;" }'
+}
+
+# print t op t op ... op t, n terms
+chain() {
+    awk -v n="$1" -v op="$2" -v t="$3" 'BEGIN {
+        printf "print %s", t
+        for( i = 1; i < n; i++ ) printf " %s %s", op, t
+        print ";"
+    }'
+}
+
+statements 2000000 | check "2M statements" "" 2000000
+statements 10000000 | check "10M statements, --stream" "--stream" 10000000
+statements 2000000 | check "2M statements, --vm" "--vm" 2000000
+
+chain 1000000 + 1 | check "1M-term +" "" 1000000
+chain 1000000 + 1 | check "1M-term +, --vm" "--vm" 1000000
+# a - b - c groups as a - (b - c), so an even number of ones comes to 0
+chain 1000000 - 1 | check "1M-term -" "" 0
+chain 1000000 '*' 1 | check "1M-term *" "" 1
+chain 1000000 + x | (echo "set x 2;"; cat) | check "1M-term + of a variable" "--stream" 2000000
+chain 1000000 + '{1, 2}' | check "1M-term + of polynomials" "" "{ 1000000, 2000000 }"
+
+exit $failed